@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "includes/mlp.hpp"
+#include "includes/optimizers.hpp"
+
+/*
+    The tape against central finite differences on a small model that uses
+    every op, then a ten-layer perceptron trained with no backward code, and
+    the peak memory of a deep, wide model with and without releasing values
+    after their last use.
+*/
+
+// Three Gaussian blobs in `features` dimensions, one-hot labels
+template <typename T>
+void blobs(Eigen::Index batch, Eigen::Index features, Eigen::Index classes, Tensor<T, 2> &X, Tensor<T, 2> &TRUE) {
+    X.resize(batch, features);
+    TRUE.resize(batch, classes);
+    X.template setRandom<Eigen::internal::NormalRandomGenerator<T>>();
+    TRUE.setZero();
+    for (Eigen::Index b = 0; b < batch; ++b) {
+        const Eigen::Index label = b % classes;
+        TRUE(b, label) = T(1);
+        X(b, label % features) += T(3);
+    }
+}
+
+template <typename Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+// Largest |tape - finite difference| over every parameter of a tanh / sigmoid / softmax model with a residual add
+void gradient_check() {
+    Tensor<double, 2> X, TRUE;
+    blobs<double>(8, 5, 4, X, TRUE);
+    ParameterArena<double> arena;
+    Dense<double> first(arena, 5, 6), second(arena, 6, 6), third(arena, 6, 4);
+    for (Dense<double> *layer : {&first, &second, &third}) layer->b.value().setRandom();
+    Tanh<double> tanh;
+    Sigmoid<double> sigmoid;
+    Softmax<double> softmax;
+
+    auto loss = [&](Tape<double> &tape) {
+        Var<double> h = tape.activation(tape.add_bias(tape.matmul(tape.input(X), tape.parameter(first.w)), tape.parameter(first.b)), tanh);
+        Var<double> g = tape.activation(tape.add_bias(tape.matmul(h, tape.parameter(second.w)), tape.parameter(second.b)), sigmoid);
+        Var<double> p = tape.activation(tape.matmul(tape.add(h, g), tape.parameter(third.w)), softmax);
+        // softmax followed by the fused loss once more exercises the VJP path
+        return tape.softmax_cross_entropy(tape.add_bias(p, tape.parameter(third.b)), TRUE);
+    };
+
+    Tape<double> tape;
+    tape.backward(loss(tape));
+
+    double worst = 0;
+    const double h = 1e-6;
+    for (Eigen::Index i = 0; i < arena.size(); ++i) {
+        double &parameter = arena.values()[i];
+        const double saved = parameter;
+        Tape<double> plus, minus;
+        parameter = saved + h;
+        const double up = plus.value(loss(plus))(0, 0);
+        parameter = saved - h;
+        const double down = minus.value(loss(minus))(0, 0);
+        parameter = saved;
+        worst = std::max(worst, std::abs(arena.grads()[i] - (up - down) / (2 * h)));
+    }
+    std::cout << "gradients against central differences, max |diff|: " << worst << " (" << tape.size() << " nodes, "
+              << arena.size() << " parameters)" << std::endl;
+}
+
+int main() {
+    gradient_check();
+
+    std::cout << std::endl << "Ten-layer ReLU perceptron, width 32, learning rate 0.1" << std::endl;
+    {
+        Tensor<float, 2> X, TRUE;
+        blobs<float>(96, 4, 3, X, TRUE);
+        std::vector<Eigen::Index> widths{4};
+        for (int l = 0; l < 9; ++l) widths.push_back(32);
+        widths.push_back(3);
+        RELU<float> relu;
+        MLP<float> model(widths, relu);
+        SGDMomentum<float> sgd(0.1f, 0.f);
+        Tape<float> tape;
+        for (int epoch = 0; epoch <= 200; ++epoch) {
+            tape.clear();
+            Var<float> loss = model.loss(tape, X, TRUE);
+            tape.backward(loss);
+            if (epoch % 40 == 0) std::cout << "epoch " << epoch << ": loss " << tape.value(loss)(0, 0) << std::endl;
+            sgd.step(model.arena);
+        }
+    }
+
+    std::cout << std::endl << "16 layers of 1024, batch 256: one forward + backward" << std::endl;
+    Tensor<float, 2> X, TRUE;
+    blobs<float>(256, 1024, 10, X, TRUE);
+    std::vector<Eigen::Index> widths(17, 1024);
+    widths.push_back(10);
+    RELU<float> relu;
+    MLP<float> model(widths, relu);
+    for (bool release : {false, true}) {
+        Tape<float> tape(release);
+        const double ms = time_ms([&] { tape.backward(model.loss(tape, X, TRUE)); });
+        std::cout << (release ? "releasing after last use: " : "keeping everything:       ") << "peak "
+                  << tape.peak_bytes() / (1024.0 * 1024.0) << " MB of intermediates, " << ms << " ms" << std::endl;
+    }
+    return 0;
+}
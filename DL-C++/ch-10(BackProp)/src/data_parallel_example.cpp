@@ -0,0 +1,94 @@
+#include <chrono>
+#include <iostream>
+#include "includes/mlp.hpp"
+#include "includes/trainer.hpp"
+
+/*
+    DataParallelTrainer on a 64 -> 256 -> 256 -> 10 ReLU perceptron with
+    Adam, mini-batches of 256 from 8192 samples of ten Gaussian blobs:
+    two runs with the same worker count give identical parameters, runs with
+    different counts agree to rounding, and an epoch is timed per worker
+    count.
+*/
+
+// Ten Gaussian blobs in 64-D, one-hot labels
+void blobs(Eigen::Index samples, Tensor<float, 2> &X, Tensor<float, 2> &TRUE) {
+    const Eigen::Index features = 64, classes = 10;
+    X.resize(samples, features);
+    TRUE.resize(samples, classes);
+    X.setRandom<Eigen::internal::NormalRandomGenerator<float>>();
+    TRUE.setZero();
+    for (Eigen::Index s = 0; s < samples; ++s) {
+        const Eigen::Index label = (s * 7) % classes;
+        TRUE(s, label) = 1.f;
+        for (Eigen::Index f = 0; f < 4; ++f) X(s, (label * 6 + f) % features) += 1.5f;
+    }
+}
+
+template <typename Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+struct Run {
+    std::vector<float> parameters;
+    float loss;
+    double ms;
+};
+
+// `epochs` passes over the data in mini-batches of 256 from the same initial weights
+Run train(const Tensor<float, 2> &X, const Tensor<float, 2> &TRUE, const std::vector<float> &initial, int workers, int epochs) {
+    RELU<float> relu;
+    MLP<float> model({64, 256, 256, 10}, relu);
+    std::copy(initial.begin(), initial.end(), model.arena.values());
+    Adam<float> adam(1e-3f);
+    DataParallelTrainer<float> trainer(
+        model.arena, [&](Tape<float> &tape, const Tensor<float, 2> &x, const Tensor<float, 2> &y) { return model.loss(tape, x, y); },
+        adam, workers);
+
+    const Eigen::Index batch = 256, samples = X.dimension(0);
+    Tensor<float, 2> x, y;
+    float loss = 0.f;
+    const double ms = time_ms([&] {
+        for (int epoch = 0; epoch < epochs; ++epoch) {
+            loss = 0.f;
+            for (Eigen::Index start = 0; start < samples; start += batch) {
+                x = X.slice(Eigen::array<Eigen::Index, 2>{start, 0}, Eigen::array<Eigen::Index, 2>{batch, X.dimension(1)});
+                y = TRUE.slice(Eigen::array<Eigen::Index, 2>{start, 0}, Eigen::array<Eigen::Index, 2>{batch, TRUE.dimension(1)});
+                loss += trainer.step(x, y) / float(samples / batch);
+            }
+        }
+    });
+    return {std::vector<float>(model.arena.values(), model.arena.values() + model.arena.size()), loss, ms};
+}
+
+float max_abs_diff(const std::vector<float> &a, const std::vector<float> &b) {
+    float worst = 0.f;
+    for (std::size_t i = 0; i < a.size(); ++i) worst = std::max(worst, std::abs(a[i] - b[i]));
+    return worst;
+}
+
+int main() {
+    Tensor<float, 2> X, TRUE;
+    blobs(8192, X, TRUE);
+    RELU<float> relu;
+    const MLP<float> init({64, 256, 256, 10}, relu);
+    const std::vector<float> initial(init.arena.values(), init.arena.values() + init.arena.size());
+
+    const Run four = train(X, TRUE, initial, 4, 1), again = train(X, TRUE, initial, 4, 1), one = train(X, TRUE, initial, 1, 1);
+    std::cout << "one epoch, max |parameter diff|: 4 workers twice " << max_abs_diff(four.parameters, again.parameters)
+              << ", 4 workers against 1 " << max_abs_diff(four.parameters, one.parameters) << std::endl;
+
+    std::cout << std::endl << "three epochs, " << get_num_threads() << " hardware thread(s)" << std::endl;
+    std::vector<int> counts{1, 2, 4};
+    for (int w = 8; w <= get_num_threads(); w *= 2) counts.push_back(w);
+    for (int workers : counts) {
+        const Run run = train(X, TRUE, initial, workers, 3);
+        std::cout << workers << " worker(s): last-epoch loss " << run.loss << ", " << 3 * X.dimension(0) / (run.ms / 1000.0)
+                  << " samples/s" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include "includes/hogwild.hpp"
+#include "includes/mlp.hpp"
+
+/*
+    Convergence per second of lock-free asynchronous SGD against the
+    synchronous data-parallel step, on a wide model over sparse inputs: a
+    1024 -> 32 -> 10 ReLU perceptron, 8192 samples with 12 active binary
+    features out of 1024 each (4 from a pool of 100 per class, 8 anywhere).
+
+    Three runs start from the same weights, all plain SGD with 4 samples
+    per worker step, timed in rounds of 32 steps; the loss over the whole
+    data set is evaluated between rounds, off the clock:
+      - Hogwild: every worker takes its own steps of batch 4 at learning
+        rate 0.2, so a round makes `workers` times as many updates;
+      - serial SGD: one worker, batch 4, learning rate 0.2, the same update
+        as a single Hogwild step. Against it, Hogwild shows how much faster
+        parallel lock-free updates converge per second;
+      - synchronous data parallel: batch 4 x workers split across the
+        workers, learning rate 0.2 x workers (linear scaling), so a round
+        moves the same samples and the same step per sample as Hogwild.
+        Against it, Hogwild shows what dropping the barrier and all-reduce
+        is worth, apart from taking more steps.
+    With one worker the three coincide up to sampling.
+*/
+
+const Eigen::Index SAMPLES = 8192, FEATURES = 1024, CLASSES = 10, ACTIVE_PER_CLASS = 100;
+
+void sparse_data(Tensor<float, 2> &X, Tensor<float, 2> &TRUE) {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<Eigen::Index> any(0, FEATURES - 1), pool(0, ACTIVE_PER_CLASS - 1);
+    X.resize(SAMPLES, FEATURES);
+    TRUE.resize(SAMPLES, CLASSES);
+    X.setZero();
+    TRUE.setZero();
+    for (Eigen::Index s = 0; s < SAMPLES; ++s) {
+        const Eigen::Index label = s % CLASSES;
+        TRUE(s, label) = 1.f;
+        for (int k = 0; k < 4; ++k) X(s, (label * ACTIVE_PER_CLASS + pool(random) * 7) % FEATURES) = 1.f;
+        for (int k = 0; k < 8; ++k) X(s, any(random)) = 1.f;
+    }
+}
+
+template <typename Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+float full_loss(const MLP<float> &model, const Tensor<float, 2> &X, const Tensor<float, 2> &TRUE) {
+    Tape<float> tape;
+    return tape.value(model.loss(tape, X, TRUE))(0, 0);
+}
+
+struct Checkpoint {
+    double ms;
+    float loss;
+};
+
+/*
+    round() trains for one round; the loss is checked after each until the
+    time budget is spent.
+*/
+template <typename Round>
+std::vector<Checkpoint> train(const MLP<float> &model, const Tensor<float, 2> &X, const Tensor<float, 2> &TRUE,
+                              double budget_ms, Round &&round) {
+    std::vector<Checkpoint> curve{{0.0, full_loss(model, X, TRUE)}};
+    double elapsed = 0.0;
+    while (elapsed < budget_ms) {
+        elapsed += time_ms(round);
+        curve.push_back({elapsed, full_loss(model, X, TRUE)});
+    }
+    return curve;
+}
+
+// First checkpoint at or below target, or "not reached"
+std::string time_to(const std::vector<Checkpoint> &curve, float target) {
+    for (const Checkpoint &c : curve) {
+        if (c.loss <= target) return std::to_string(int(c.ms + 0.5)) + " ms";
+    }
+    return "not reached";
+}
+
+int main() {
+    Tensor<float, 2> X, TRUE;
+    sparse_data(X, TRUE);
+    RELU<float> relu;
+    const MLP<float> init({FEATURES, 32, CLASSES}, relu);
+    const std::vector<float> initial(init.arena.values(), init.arena.values() + init.arena.size());
+
+    const int workers = get_num_threads();
+    const Eigen::Index batch = 4, steps = 32;
+    const float learning_rate = 0.2f;
+    const double budget_ms = 1000.0;
+
+    MLP<float> async_model({FEATURES, 32, CLASSES}, relu);
+    std::copy(initial.begin(), initial.end(), async_model.arena.values());
+    HogwildTrainer<float> hogwild(
+        async_model.arena, [&](Tape<float> &tape, const Tensor<float, 2> &x, const Tensor<float, 2> &y) { return async_model.loss(tape, x, y); },
+        X, TRUE, learning_rate, batch, workers, 1);
+    const std::vector<Checkpoint> async_curve = train(async_model, X, TRUE, budget_ms, [&] { hogwild.run(steps); });
+
+    // DataParallelTrainer on batches of batch x sync_workers at rate, from the same weights
+    auto synchronous = [&](int sync_workers, float rate) {
+        MLP<float> sync_model({FEATURES, 32, CLASSES}, relu);
+        std::copy(initial.begin(), initial.end(), sync_model.arena.values());
+        SGDMomentum<float> sgd(rate, 0.f);
+        DataParallelTrainer<float> trainer(
+            sync_model.arena, [&](Tape<float> &tape, const Tensor<float, 2> &x, const Tensor<float, 2> &y) { return sync_model.loss(tape, x, y); },
+            sgd, sync_workers);
+        std::mt19937 random(1);
+        std::uniform_int_distribution<Eigen::Index> pick(0, SAMPLES - 1);
+        Tensor<float, 2> x(batch * sync_workers, FEATURES), y(batch * sync_workers, CLASSES);
+        return train(sync_model, X, TRUE, budget_ms, [&] {
+            for (Eigen::Index step = 0; step < steps; ++step) {
+                for (Eigen::Index b = 0; b < x.dimension(0); ++b) {
+                    const Eigen::Index sample = pick(random);
+                    x.chip(b, 0) = X.chip(sample, 0);
+                    y.chip(b, 0) = TRUE.chip(sample, 0);
+                }
+                trainer.step(x, y);
+            }
+        });
+    };
+    const std::vector<Checkpoint> serial_curve = synchronous(1, learning_rate);
+    const std::vector<Checkpoint> sync_curve = synchronous(workers, learning_rate * float(workers));
+
+    std::cout << workers << " worker(s), " << batch << " samples per worker step; learning rate " << learning_rate
+              << " for Hogwild and serial SGD, " << learning_rate * float(workers) << " for synchronous" << std::endl;
+    std::cout << "rounds of " << steps << " steps in " << budget_ms << " ms: Hogwild " << async_curve.size() - 1 << ", serial "
+              << serial_curve.size() - 1 << ", synchronous " << sync_curve.size() - 1 << std::endl;
+    const std::vector<std::pair<const char *, const std::vector<Checkpoint> *>> runs{
+        {"Hogwild", &async_curve}, {"serial", &serial_curve}, {"synchronous", &sync_curve}};
+    std::size_t longest = 0;
+    for (const auto &run : runs) longest = std::max(longest, run.second->size());
+    const std::size_t every = std::max<std::size_t>(1, longest / 8);
+    for (std::size_t i = 0; i < longest; i += every) {
+        std::cout << "checkpoint " << i << ":";
+        for (const auto &run : runs) {
+            if (i < run.second->size()) std::cout << " " << run.first << " " << (*run.second)[i].ms << " ms loss " << (*run.second)[i].loss << ";";
+        }
+        std::cout << std::endl;
+    }
+    for (float target : {1.0f, 0.3f, 0.1f}) {
+        std::cout << "time to full-data loss " << target << ":";
+        for (const auto &run : runs) std::cout << " " << run.first << " " << time_to(*run.second, target) << ";";
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#ifndef __MY_ACTIVATIONS__
+#define __MY_ACTIVATIONS__
+
+#include <cmath>
+#include <stdexcept>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+template <typename T, int Rank>
+using Tensor = Eigen::Tensor<T, Rank>;
+
+/*
+    Activations of a batch x n pre-activation Z, with what backprop needs
+    to turn dC/dY into dC/dZ.
+
+    ReLU, sigmoid and tanh are elementwise: y_i depends on z_i only, so the
+    per-sample Jacobian dY/dZ is diagonal and dC/dZ is the Hadamard product
+        dC/dZ = dC/dY * derivative(Z, Y)
+    in O(batch * n) time and memory.
+
+    Softmax is not: every y_i depends on the whole row. Its vector-Jacobian
+    product still needs no Jacobian, since J = diag(y) - y y^T gives
+        dC/dz_i = y_i * (dC/dy_i - sum_j dC/dy_j * y_j)
+    per row, again O(n).
+
+    jacobian() materialises the full batch x n x n tensor. It is only there
+    as a reference for tests: for a 4096-wide layer it is 64 MB per sample.
+
+    All four derivatives here are functions of Y alone (ReLU's through
+    y > 0), so a caller that keeps only Y for the backward pass can hand an
+    empty Z to derivative() and vjp() when needs_input() is false.
+*/
+
+template <typename T>
+class Activation {
+public:
+    virtual ~Activation() = default;
+
+    virtual Tensor<T, 2> evaluate(const Tensor<T, 2> &z) const = 0;
+
+    // True when the Jacobian is diagonal, so backprop can use derivative()
+    virtual bool elementwise() const = 0;
+
+    // Diagonal of dY/dZ, batch x n; only defined for elementwise activations
+    virtual Tensor<T, 2> derivative(const Tensor<T, 2> &z, const Tensor<T, 2> &y) const = 0;
+
+    // False when derivative() and vjp() ignore Z
+    virtual bool needs_input() const { return true; }
+
+    // dC/dZ from dC/dY, without forming the Jacobian
+    virtual Tensor<T, 2> vjp(const Tensor<T, 2> &dc_dy, const Tensor<T, 2> &z, const Tensor<T, 2> &y) const {
+        return dc_dy * derivative(z, y);
+    }
+
+    // J[b, i, j] = dy_j / dz_i for sample b (reference only)
+    virtual Tensor<T, 3> jacobian(const Tensor<T, 2> &z, const Tensor<T, 2> &y) const {
+        const Tensor<T, 2> diagonal = derivative(z, y);
+        Tensor<T, 3> J(z.dimension(0), z.dimension(1), z.dimension(1));
+        J.setZero();
+        for (Eigen::Index b = 0; b < z.dimension(0); ++b)
+        for (Eigen::Index i = 0; i < z.dimension(1); ++i) J(b, i, i) = diagonal(b, i);
+        return J;
+    }
+};
+
+template <typename T>
+class RELU : public Activation<T> {
+public:
+    Tensor<T, 2> evaluate(const Tensor<T, 2> &z) const override { return z.cwiseMax(T(0)); }
+    bool elementwise() const override { return true; }
+    bool needs_input() const override { return false; }
+    Tensor<T, 2> derivative(const Tensor<T, 2> &, const Tensor<T, 2> &y) const override {
+        return (y > y.constant(T(0))).template cast<T>();
+    }
+};
+
+template <typename T>
+class Sigmoid : public Activation<T> {
+public:
+    Tensor<T, 2> evaluate(const Tensor<T, 2> &z) const override { return z.sigmoid(); }
+    bool elementwise() const override { return true; }
+    bool needs_input() const override { return false; }
+    Tensor<T, 2> derivative(const Tensor<T, 2> &, const Tensor<T, 2> &y) const override {
+        return y * (y.constant(T(1)) - y);
+    }
+};
+
+template <typename T>
+class Tanh : public Activation<T> {
+public:
+    Tensor<T, 2> evaluate(const Tensor<T, 2> &z) const override { return z.tanh(); }
+    bool elementwise() const override { return true; }
+    bool needs_input() const override { return false; }
+    Tensor<T, 2> derivative(const Tensor<T, 2> &, const Tensor<T, 2> &y) const override {
+        return y.constant(T(1)) - y * y;
+    }
+};
+
+template <typename T>
+class Softmax : public Activation<T> {
+public:
+    // Row-wise, shifted by the row maximum
+    Tensor<T, 2> evaluate(const Tensor<T, 2> &z) const override {
+        const Eigen::Index batch = z.dimension(0), n = z.dimension(1);
+        const Eigen::array<Eigen::Index, 2> column{batch, 1}, across{1, n};
+        const Eigen::array<int, 1> rows{1};
+        const Tensor<T, 2> shifted = (z - z.maximum(rows).reshape(column).broadcast(across)).exp();
+        return shifted / shifted.sum(rows).reshape(column).broadcast(across);
+    }
+
+    bool elementwise() const override { return false; }
+    bool needs_input() const override { return false; }
+
+    Tensor<T, 2> derivative(const Tensor<T, 2> &, const Tensor<T, 2> &) const override {
+        throw std::logic_error("Softmax has no elementwise derivative; use vjp()");
+    }
+
+    Tensor<T, 2> vjp(const Tensor<T, 2> &dc_dy, const Tensor<T, 2> &, const Tensor<T, 2> &y) const override {
+        const Eigen::Index batch = y.dimension(0), n = y.dimension(1);
+        const Eigen::array<int, 1> rows{1};
+        const Tensor<T, 2> dot = (dc_dy * y).sum(rows).reshape(Eigen::array<Eigen::Index, 2>{batch, 1})
+                                     .broadcast(Eigen::array<Eigen::Index, 2>{1, n});
+        return y * (dc_dy - dot);
+    }
+
+    Tensor<T, 3> jacobian(const Tensor<T, 2> &, const Tensor<T, 2> &y) const override {
+        Tensor<T, 3> J(y.dimension(0), y.dimension(1), y.dimension(1));
+        for (Eigen::Index b = 0; b < y.dimension(0); ++b)
+        for (Eigen::Index i = 0; i < y.dimension(1); ++i)
+        for (Eigen::Index j = 0; j < y.dimension(1); ++j) J(b, i, j) = (i == j ? y(b, i) : T(0)) - y(b, i) * y(b, j);
+        return J;
+    }
+};
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef __MY_AUTOGRAD__
+#define __MY_AUTOGRAD__
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include "activations.hpp"
+#include "gemm.hpp"
+#include "parameters.hpp"
+
+/*
+    Reverse-mode automatic differentiation on a tape.
+
+    Every op on a Tape computes its batch x n result at once and appends a
+    node holding the result and a backward step. backward(loss) seeds
+    dC/dloss = 1 and replays the steps in reverse order; each step adds its
+    node's gradient, pushed through the op, into the gradients of its inputs,
+    so models of any depth need no hand-written backward code:
+
+        Tape<float> tape;
+        Var<float> h = tape.input(X);
+        for (auto &layer : layers) h = tape.activation(tape.add_bias(tape.matmul(h, tape.parameter(layer.w)),
+                                                                    tape.parameter(layer.b)), relu);
+        Var<float> loss = tape.softmax_cross_entropy(h, TRUE);
+        tape.backward(loss);    // layer.w.grad(), layer.b.grad() now hold dC/dW, dC/db
+
+    Memory. A node's value is kept only while something can still read it:
+    a Var handle on it (later ops) or a backward step that saved it. Each op
+    saves only what its own backward reads: matmul its two inputs, the
+    activations their output Y (see needs_input() in activations.hpp), the
+    fused softmax cross-entropy its probabilities, bias add and add nothing.
+    So Z = X W is freed as soon as ReLU(Z) has been computed and its handle
+    dropped, and during backward every value is freed right after the last
+    step that reads it has run, along with the node's gradient.
+
+    Gradient buffers are sized when the op is recorded and zero-filled just
+    before the first backward step that accumulates into them, so the step
+    kernels write in place (gemm with beta = 1, +=) and no gradient of an
+    intermediate exists before backward reaches it. Parameter gradients are
+    the parameters' slots in their ParameterArena (or in a worker's private
+    copy, see redirect_gradients()), accumulated across backward() calls
+    until an optimizer step or zero_grad() clears them.
+
+    Inputs and parameters are referenced, not copied: they must outlive the
+    tape's use of them, and Var handles must not outlive the tape.
+*/
+
+template <typename T>
+class Tape;
+
+// Handle on a tape node; the node's value is released once no handle or backward step needs it
+template <typename T>
+class Var {
+public:
+    Var() = default;
+    Var(const Var &other) : Var(other.valid() ? other.tape_ : nullptr, other.id_) {}
+    Var(Var &&other) noexcept : tape_(other.tape_), id_(other.id_), generation_(other.generation_) { other.tape_ = nullptr; }
+    Var &operator=(Var other) noexcept {
+        std::swap(tape_, other.tape_);
+        std::swap(id_, other.id_);
+        std::swap(generation_, other.generation_);
+        return *this;
+    }
+    ~Var() {
+        if (tape_ != nullptr && tape_->generation_ == generation_) tape_->drop_handle(id_);
+    }
+
+    Eigen::Index id() const { return id_; }
+    bool valid() const { return tape_ != nullptr && tape_->generation_ == generation_; }
+
+private:
+    friend class Tape<T>;
+
+    Var(Tape<T> *tape, Eigen::Index id) : tape_(tape), id_(id), generation_(tape != nullptr ? tape->generation_ : 0) {
+        if (tape_ != nullptr) ++tape_->nodes_[id_].handles;
+    }
+
+    Tape<T> *tape_ = nullptr;
+    Eigen::Index id_ = -1;
+    std::size_t generation_ = 0;
+};
+
+template <typename T>
+class Tape {
+public:
+    using ConstMap = Eigen::TensorMap<const Tensor<T, 2>>;
+    using Map = Eigen::TensorMap<Tensor<T, 2>>;
+
+    // release = false keeps every value and gradient until clear(), for comparison
+    explicit Tape(bool release = true) : release_(release) {}
+    Tape(const Tape &) = delete;
+    Tape &operator=(const Tape &) = delete;
+
+    // Constant leaf; x is read in place
+    Var<T> input(const Tensor<T, 2> &x) {
+        Node &node = append(x.dimension(0), x.dimension(1), false);
+        node.external = x.data();
+        return handle();
+    }
+
+    // Trainable leaf; backward() accumulates into p.grad()
+    Var<T> parameter(const Parameter<T> &p) {
+        Node &node = append(p.rows(), p.cols(), true);
+        node.external = p.value().data();
+        node.parameter = &p;
+        return handle();
+    }
+
+    // a (m x k) b (k x n)
+    Var<T> matmul(const Var<T> &a, const Var<T> &b) {
+        const Eigen::Index m = rows(a), k = cols(a), n = cols(b);
+        if (rows(b) != k) throw std::invalid_argument("matmul: inner dimensions differ");
+        Node &node = append(m, n, requires_grad(a) || requires_grad(b), {a.id(), b.id()});
+        allocate_value(node);
+        gemm<T>(false, false, m, n, k, T(1), data(a.id()), m, data(b.id()), k, T(0), node.value.data(), m);
+        save(node, a.id());
+        save(node, b.id());
+        node.backward = [](Tape &tape, Eigen::Index id) {
+            const Node &node = tape.nodes_[id];
+            const Eigen::Index A = node.inputs[0], B = node.inputs[1];
+            const Eigen::Index m = node.rows, n = node.cols, k = tape.nodes_[A].cols;
+            if (tape.nodes_[A].requires_grad) {    // dA += dC B^T
+                gemm<T>(false, true, m, k, n, T(1), node.grad.data(), m, tape.data(B), k, T(1), tape.grad(A), m);
+            }
+            if (tape.nodes_[B].requires_grad) {    // dB += A^T dC
+                gemm<T>(true, false, k, n, m, T(1), tape.data(A), m, node.grad.data(), m, T(1), tape.grad(B), k);
+            }
+        };
+        return handle();
+    }
+
+    // a (batch x n) + bias (1 x n) on every row
+    Var<T> add_bias(const Var<T> &a, const Var<T> &bias) {
+        const Eigen::Index batch = rows(a), n = cols(a);
+        if (rows(bias) != 1 || cols(bias) != n) throw std::invalid_argument("add_bias: bias must be 1 x n");
+        Node &node = append(batch, n, requires_grad(a) || requires_grad(bias), {a.id(), bias.id()});
+        allocate_value(node);
+        node.value = view(a.id()) + view(bias.id()).broadcast(Eigen::array<Eigen::Index, 2>{batch, 1});
+        node.backward = [](Tape &tape, Eigen::Index id) {
+            const Node &node = tape.nodes_[id];
+            const Eigen::Index A = node.inputs[0], bias = node.inputs[1];
+            if (tape.nodes_[A].requires_grad) tape.grad_view(A) += node.grad;
+            if (tape.nodes_[bias].requires_grad) {
+                tape.grad_view(bias) += node.grad.sum(Eigen::array<int, 1>{0}).reshape(Eigen::array<Eigen::Index, 2>{1, node.cols});
+            }
+        };
+        return handle();
+    }
+
+    // a + b, same shape (residual connections)
+    Var<T> add(const Var<T> &a, const Var<T> &b) {
+        if (rows(a) != rows(b) || cols(a) != cols(b)) throw std::invalid_argument("add: shapes differ");
+        Node &node = append(rows(a), cols(a), requires_grad(a) || requires_grad(b), {a.id(), b.id()});
+        allocate_value(node);
+        node.value = view(a.id()) + view(b.id());
+        node.backward = [](Tape &tape, Eigen::Index id) {
+            const Node &node = tape.nodes_[id];
+            for (Eigen::Index input : node.inputs) {
+                if (tape.nodes_[input].requires_grad) tape.grad_view(input) += node.grad;
+            }
+        };
+        return handle();
+    }
+
+    // f(z); f must outlive backward()
+    Var<T> activation(const Var<T> &z, const Activation<T> &f) {
+        Node &node = append(rows(z), cols(z), requires_grad(z), {z.id()});
+        const Node &in = nodes_[z.id()];
+        node.value = f.evaluate(in.external == nullptr ? in.value : Tensor<T, 2>(view(z.id())));
+        account(node.value.size());
+        save(node, node.id);
+        if (f.needs_input()) save(node, z.id());
+        node.backward = [&f](Tape &tape, Eigen::Index id) {
+            const Node &node = tape.nodes_[id];
+            const Eigen::Index Z = node.inputs[0];
+            if (!tape.nodes_[Z].requires_grad) return;
+            const Tensor<T, 2> z = f.needs_input() ? Tensor<T, 2>(tape.view(Z)) : Tensor<T, 2>();
+            if (f.elementwise()) {
+                tape.grad_view(Z) += node.grad * f.derivative(z, node.value);
+            } else {
+                tape.grad_view(Z) += f.vjp(node.grad, z, node.value);
+            }
+        };
+        return handle();
+    }
+
+    /*
+        Mean over the batch of the categorical cross-entropy of softmax(logits)
+        against one-hot (or soft) labels, as a 1 x 1 node. Fused, the gradient
+        is (softmax(logits) - labels) / batch, with no division by y.
+    */
+    Var<T> softmax_cross_entropy(const Var<T> &logits, const Tensor<T, 2> &labels) {
+        const Eigen::Index batch = rows(logits), n = cols(logits);
+        if (labels.dimension(0) != batch || labels.dimension(1) != n) {
+            throw std::invalid_argument("softmax_cross_entropy: labels must match the logits");
+        }
+        Node &node = append(1, 1, requires_grad(logits), {logits.id()});
+        const Eigen::array<Eigen::Index, 2> column{batch, 1}, across{1, n};
+        const Eigen::array<int, 1> by_row{1};
+        const ConstMap z = view(logits.id());
+        const Tensor<T, 2> shifted = z - z.maximum(by_row).reshape(column).broadcast(across);
+        const Tensor<T, 2> log_sum = shifted.exp().sum(by_row).log().reshape(column);
+        const Eigen::Tensor<T, 0> total = (labels * (shifted - log_sum.broadcast(across))).sum();
+        allocate_value(node);
+        node.value(0, 0) = -total() / T(batch);
+        if (node.requires_grad) {
+            node.saved = (shifted - log_sum.broadcast(across)).exp();
+            account(node.saved.size());
+            node.labels = &labels;
+        }
+        node.backward = [](Tape &tape, Eigen::Index id) {
+            Node &node = tape.nodes_[id];
+            const Eigen::Index Z = node.inputs[0];
+            const T scale = node.grad(0, 0) / T(node.saved.dimension(0));
+            tape.grad_view(Z) += (node.saved - *node.labels) * node.saved.constant(scale);
+        };
+        return handle();
+    }
+
+    /*
+        Reverse replay from a 1 x 1 loss, seeded with dC/dloss = seed (a data-parallel
+        worker passes its shard's share of the batch); each value and intermediate
+        gradient is freed after its last use.
+    */
+    void backward(const Var<T> &loss, T seed = T(1)) {
+        if (!loss.valid() || loss.tape_ != this) throw std::invalid_argument("backward: loss is not on this tape");
+        if (rows(loss) != 1 || cols(loss) != 1) throw std::invalid_argument("backward: loss must be 1 x 1");
+        if (replayed_) throw std::logic_error("backward: the tape has already been replayed; clear() it first");
+        replayed_ = true;
+
+        const Eigen::Index top = loss.id();
+        if (nodes_[top].requires_grad) grad(top)[0] += seed;
+        for (Eigen::Index id = top; id >= 0; --id) {
+            Node &node = nodes_[id];
+            if (node.backward && node.grad_ready) node.backward(*this, id);
+            for (Eigen::Index input : node.saved_inputs) unsave(input);
+            if (node.saves_self) unsave(id);
+            if (release_ && node.parameter == nullptr) {
+                release_tensor(node.grad);
+                node.grad_ready = false;
+                release_tensor(node.saved);
+            }
+        }
+    }
+
+    /*
+        Parameter gradients accumulate into gradients[p.offset() ...], a private
+        arena-sized buffer, instead of the arena's own (one per data-parallel
+        worker); nullptr restores the arena.
+    */
+    void redirect_gradients(T *gradients) { gradients_ = gradients; }
+
+    // Value of a node, batch x n (1 x 1 for a loss); throws once it has been released
+    Tensor<T, 2> value(const Var<T> &v) const {
+        if (!v.valid() || v.tape_ != this) throw std::invalid_argument("value: handle is not on this tape");
+        return view(v.id());
+    }
+
+    // Forget every node, invalidating all handles
+    void clear() {
+        ++generation_;
+        nodes_.clear();
+        live_ = peak_ = 0;
+        replayed_ = false;
+    }
+
+    Eigen::Index size() const { return Eigen::Index(nodes_.size()); }
+
+    // Bytes of intermediate values, gradients and saved state currently held, and the most held at once
+    std::size_t live_bytes() const { return live_ * sizeof(T); }
+    std::size_t peak_bytes() const { return peak_ * sizeof(T); }
+
+private:
+    friend class Var<T>;
+
+    struct Node {
+        Eigen::Index id = 0, rows = 0, cols = 0;
+        std::vector<Eigen::Index> inputs;
+        Tensor<T, 2> value;                      // intermediates only
+        const T *external = nullptr;             // inputs and parameters
+        const Parameter<T> *parameter = nullptr;
+        Tensor<T, 2> grad;                       // intermediates only, from the first backward step that writes it
+        bool grad_ready = false;
+        Tensor<T, 2> saved;                      // op state for the backward step
+        const Tensor<T, 2> *labels = nullptr;
+        std::vector<Eigen::Index> saved_inputs;  // inputs whose values the backward step reads
+        bool saves_self = false;
+        bool requires_grad = false;
+        int handles = 0, pending = 0;            // live Var handles, backward steps still to read the value
+        std::function<void(Tape &, Eigen::Index)> backward;
+    };
+
+    Node &append(Eigen::Index rows, Eigen::Index cols, bool requires_grad, std::vector<Eigen::Index> inputs = {}) {
+        if (replayed_) throw std::logic_error("Tape: cannot record after backward(); clear() it first");
+        for (Eigen::Index input : inputs) {
+            if (nodes_[input].external == nullptr && nodes_[input].value.size() == 0) {
+                throw std::logic_error("Tape: input value has already been released");
+            }
+        }
+        Node node;
+        node.id = Eigen::Index(nodes_.size());
+        node.rows = rows;
+        node.cols = cols;
+        node.requires_grad = requires_grad;
+        node.inputs = std::move(inputs);
+        nodes_.push_back(std::move(node));
+        return nodes_.back();
+    }
+
+    Var<T> handle() { return Var<T>(this, Eigen::Index(nodes_.size()) - 1); }
+
+    void allocate_value(Node &node) {
+        node.value.resize(node.rows, node.cols);
+        account(node.value.size());
+    }
+
+    // The backward step of node reads the value of id
+    void save(Node &node, Eigen::Index id) {
+        if (!node.requires_grad) return;
+        if (id == node.id) {
+            node.saves_self = true;
+        } else {
+            node.saved_inputs.push_back(id);
+        }
+        ++nodes_[id].pending;
+    }
+
+    void unsave(Eigen::Index id) {
+        --nodes_[id].pending;
+        release_value(id);
+    }
+
+    void drop_handle(Eigen::Index id) {
+        --nodes_[id].handles;
+        release_value(id);
+    }
+
+    void release_value(Eigen::Index id) {
+        Node &node = nodes_[id];
+        if (release_ && node.handles == 0 && node.pending == 0) release_tensor(node.value);
+    }
+
+    void release_tensor(Tensor<T, 2> &t) {
+        live_ -= std::size_t(t.size());
+        t = Tensor<T, 2>();
+    }
+
+    void account(Eigen::Index elements) {
+        live_ += std::size_t(elements);
+        peak_ = std::max(peak_, live_);
+    }
+
+    bool requires_grad(const Var<T> &v) const { return nodes_[v.id()].requires_grad; }
+    Eigen::Index rows(const Var<T> &v) const { return nodes_[v.id()].rows; }
+    Eigen::Index cols(const Var<T> &v) const { return nodes_[v.id()].cols; }
+
+    const T *data(Eigen::Index id) const {
+        const Node &node = nodes_[id];
+        if (node.external != nullptr) return node.external;
+        if (node.value.size() == 0) throw std::logic_error("Tape: value has already been released");
+        return node.value.data();
+    }
+
+    ConstMap view(Eigen::Index id) const { return ConstMap(data(id), nodes_[id].rows, nodes_[id].cols); }
+
+    // Gradient buffer of id, zero-filled on first use
+    T *grad(Eigen::Index id) {
+        Node &node = nodes_[id];
+        if (node.parameter != nullptr) {
+            return gradients_ != nullptr ? gradients_ + node.parameter->offset() : node.parameter->grad().data();
+        }
+        if (!node.grad_ready) {
+            node.grad.resize(node.rows, node.cols);
+            node.grad.setZero();
+            node.grad_ready = true;
+            account(node.grad.size());
+        }
+        return node.grad.data();
+    }
+
+    Map grad_view(Eigen::Index id) { return Map(grad(id), nodes_[id].rows, nodes_[id].cols); }
+
+    std::vector<Node> nodes_;
+    T *gradients_ = nullptr;
+    bool release_;
+    bool replayed_ = false;
+    std::size_t generation_ = 1;
+    std::size_t live_ = 0, peak_ = 0;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef __MY_HOGWILD__
+#define __MY_HOGWILD__
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "trainer.hpp"
+
+/*
+    Asynchronous lock-free SGD (Hogwild!, Niu, Recht, Re & Wright 2011).
+
+    Every worker loops on its own: it samples a mini-batch with its own
+    generator, records the model on its own tape over the shared parameter
+    values, backpropagates into a private gradient buffer and applies
+        p -= learning_rate * g
+    straight to the shared arena. There is no barrier, reduction or lock:
+    workers read parameters while others write them, and an update can
+    overwrite a concurrent one. When each step touches few coordinates (a
+    wide model on sparse inputs) such collisions are rare and cost little
+    progress, while every core keeps computing instead of waiting for the
+    slowest shard and an all-reduce over the whole model.
+
+    The races are deliberate and benign on the targets this code runs on:
+    floats are read and written whole, never torn, so a lost update just
+    drops one step's contribution. Strictly they are data races in the C++
+    memory model, as in every Hogwild implementation; relaxed atomic
+    loads/stores would compile to the same moves but stop the update from
+    vectorizing.
+
+    To keep shared cache lines from bouncing between cores, the update goes
+    over the gradient in groups of the parameters that share a 64-byte cache
+    line, with the boundaries taken from the parameter addresses (the
+    arena's storage is line-aligned), and writes a group only when its
+    gradient has a nonzero: of a first-layer weight, only the lines holding
+    rows of features active in the batch. The private gradient is zeroed in
+    the same pass.
+
+    A run is not reproducible with more than one worker; use the
+    DataParallelTrainer when it has to be.
+*/
+
+template <typename T>
+class HogwildTrainer {
+public:
+    HogwildTrainer(ParameterArena<T> &arena, LossFunction<T> loss, const Tensor<T, 2> &X, const Tensor<T, 2> &TRUE,
+                   T learning_rate, Eigen::Index batch, int workers = get_num_threads(), unsigned seed = 0)
+        : arena_(arena), loss_(std::move(loss)), X_(X), TRUE_(TRUE), learning_rate_(learning_rate), batch_(batch) {
+        if (X.dimension(0) != TRUE.dimension(0)) throw std::invalid_argument("HogwildTrainer: X and TRUE sample counts differ");
+        if (batch < 1 || batch > X.dimension(0)) throw std::invalid_argument("HogwildTrainer: batch must be in [1, samples]");
+        if (workers < 1) throw std::invalid_argument("HogwildTrainer: needs at least one worker");
+        for (int w = 0; w < workers; ++w) workers_.push_back(std::make_unique<Worker>(seed * 7919u + unsigned(w)));
+    }
+
+    // Every worker takes `steps` SGD steps concurrently; returns the mean mini-batch loss over them
+    T run(Eigen::Index steps) {
+        const Eigen::Index count = workers();
+        for (auto &worker : workers_) {
+            if (Eigen::Index(worker->grads.size()) != arena_.size()) worker->grads.assign(arena_.size(), T(0));
+        }
+        parallel_for(count, [&](Eigen::Index begin, Eigen::Index end) {
+            for (Eigen::Index w = begin; w < end; ++w) work(*workers_[w], steps);
+        }, int(count));
+
+        T loss = T(0);
+        for (const auto &worker : workers_) loss += worker->loss;
+        return loss / T(count * std::max<Eigen::Index>(steps, 1));
+    }
+
+    Eigen::Index workers() const { return Eigen::Index(workers_.size()); }
+
+private:
+    struct Worker {
+        explicit Worker(unsigned seed) : random(seed) {}
+        std::mt19937 random;
+        Tape<T> tape;
+        std::vector<T> grads;    // arena-sized, zero between steps
+        Tensor<T, 2> X, TRUE;    // this step's mini-batch
+        T loss = T(0);           // sum of this run's mini-batch losses
+    };
+
+    void work(Worker &worker, Eigen::Index steps) {
+        std::uniform_int_distribution<Eigen::Index> pick(0, X_.dimension(0) - 1);
+        worker.X.resize(batch_, X_.dimension(1));
+        worker.TRUE.resize(batch_, TRUE_.dimension(1));
+        worker.loss = T(0);
+        for (Eigen::Index step = 0; step < steps; ++step) {
+            for (Eigen::Index b = 0; b < batch_; ++b) {
+                const Eigen::Index sample = pick(worker.random);
+                worker.X.chip(b, 0) = X_.chip(sample, 0);
+                worker.TRUE.chip(b, 0) = TRUE_.chip(sample, 0);
+            }
+            worker.tape.clear();
+            worker.tape.redirect_gradients(worker.grads.data());
+            const Var<T> loss = loss_(worker.tape, worker.X, worker.TRUE);
+            worker.loss += worker.tape.value(loss)(0, 0);
+            worker.tape.backward(loss);
+            apply(worker.grads.data());
+        }
+    }
+
+    // Shared p -= learning_rate * g over the cache lines of p whose part of g holds a nonzero; g is left zeroed
+    void apply(T *g) {
+        constexpr Eigen::Index LINE = Eigen::Index(ARENA_ALIGNMENT / sizeof(T));
+        T *p = arena_.values();
+        const Eigen::Index size = arena_.size();
+        auto update = [&](Eigen::Index begin, Eigen::Index end) {
+            int nonzero = 0;
+            for (Eigen::Index i = begin; i < end; ++i) nonzero += g[i] != T(0);
+            if (nonzero == 0) return;
+            for (Eigen::Index i = begin; i < end; ++i) {
+                p[i] -= learning_rate_ * g[i];
+                g[i] = T(0);
+            }
+        };
+        // Elements before the first line boundary; none for the arena's aligned storage
+        const std::uintptr_t misalignment = reinterpret_cast<std::uintptr_t>(p) % ARENA_ALIGNMENT;
+        const Eigen::Index head = std::min(size, Eigen::Index((ARENA_ALIGNMENT - misalignment) % ARENA_ALIGNMENT / sizeof(T)));
+        update(0, head);
+        Eigen::Index line = head;
+        for (; line + LINE <= size; line += LINE) update(line, line + LINE);
+        update(line, size);
+    }
+
+    ParameterArena<T> &arena_;
+    LossFunction<T> loss_;
+    const Tensor<T, 2> &X_, &TRUE_;
+    T learning_rate_;
+    Eigen::Index batch_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __MY_MLP__
+#define __MY_MLP__
+
+#include <cmath>
+#include <vector>
+#include "autograd.hpp"
+
+/*
+    Multilayer perceptron on the tape: Dense layers Y = X W + b with their
+    parameters in one ParameterArena, so an optimizer or a gradient
+    reduction sees the whole model as one flat buffer. Weights start as
+    N(0, 1 / fan_in), biases at zero.
+*/
+
+template <typename T>
+struct Dense {
+    const Parameter<T> &w, &b;
+
+    Dense(ParameterArena<T> &arena, Eigen::Index in, Eigen::Index out) : w(arena.add(in, out)), b(arena.add(1, out)) {
+        w.value().template setRandom<Eigen::internal::NormalRandomGenerator<T>>();
+        w.value() = w.value() * w.value().constant(T(1) / std::sqrt(T(in)));
+    }
+
+    Var<T> forward(Tape<T> &tape, const Var<T> &x) const {
+        return tape.add_bias(tape.matmul(x, tape.parameter(w)), tape.parameter(b));
+    }
+};
+
+// widths.front() inputs, widths.back() classes; hidden layers use `hidden`, which must outlive the model
+template <typename T>
+struct MLP {
+    ParameterArena<T> arena;
+    std::vector<Dense<T>> layers;
+    const Activation<T> &hidden;
+
+    MLP(const std::vector<Eigen::Index> &widths, const Activation<T> &hidden) : hidden(hidden) {
+        if (widths.size() < 2) throw std::invalid_argument("MLP: needs input and output widths");
+        for (std::size_t l = 0; l + 1 < widths.size(); ++l) layers.emplace_back(arena, widths[l], widths[l + 1]);
+    }
+
+    Var<T> logits(Tape<T> &tape, const Tensor<T, 2> &X) const {
+        Var<T> h = tape.input(X);
+        for (std::size_t l = 0; l < layers.size(); ++l) {
+            h = layers[l].forward(tape, h);
+            if (l + 1 < layers.size()) h = tape.activation(h, hidden);
+        }
+        return h;
+    }
+
+    // Mean softmax cross-entropy against one-hot labels
+    Var<T> loss(Tape<T> &tape, const Tensor<T, 2> &X, const Tensor<T, 2> &TRUE) const {
+        return tape.softmax_cross_entropy(logits(tape, X), TRUE);
+    }
+};
+
+#endif
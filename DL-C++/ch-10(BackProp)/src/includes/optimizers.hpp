@@ -0,0 +1,179 @@
+#ifndef __MY_OPTIMIZERS__
+#define __MY_OPTIMIZERS__
+
+#include <cmath>
+#include <vector>
+#include "parallel.hpp"
+#include "parameters.hpp"
+
+/*
+    First-order optimizers over a whole ParameterArena.
+
+    step() is one pass over the flat value, gradient and state buffers: each
+    element's gradient is read once, its state and value updated and stored,
+    and the gradient zeroed for the next backward pass, all in registers,
+    Eigen packet by packet with a scalar tail. Written as separate tensor
+    expressions per parameter, Adam streams the same buffers four or five
+    times; the update is bound by memory bandwidth, so the single pass is
+    what makes it fast. Large arenas are split across threads in contiguous
+    ranges (elementwise, so the result does not depend on the split).
+
+    SGDMomentum (PyTorch's convention, dampening 0):
+        g = grad + weight_decay * p
+        v = momentum * v + g
+        p -= learning_rate * (nesterov ? g + momentum * v : v)
+
+    Adam, with the bias corrections folded into the step size and epsilon
+    (Kingma & Ba, section 2):
+        g = grad + weight_decay * p                       (L2, Adam only)
+        m = beta1 * m + (1 - beta1) * g
+        v = beta2 * v + (1 - beta2) * g * g
+        p -= learning_rate * sqrt(1 - beta2^t) / (1 - beta1^t) * m / (sqrt(v) + epsilon * sqrt(1 - beta2^t))
+
+    AdamW decouples the weight decay from the gradient statistics (Loshchilov
+    & Hutter): p *= 1 - learning_rate * weight_decay before the Adam step,
+    with g = grad.
+
+    Unused terms (weight decay 0, no Nesterov) are multiplications by 0 or 1
+    rather than branches; the pass is memory bound, so they cost nothing.
+*/
+
+// Elements per thread below which a step stays on the calling thread
+constexpr Eigen::Index OPTIMIZER_GRAIN = Eigen::Index(1) << 16;
+
+// Packet types as template arguments drop __m128's alignment attribute, which is harmless here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+// update(Packet(), i) over packets of [begin, end), then update(T(), i) over the tail
+template <typename T, typename Update>
+void packet_loop(Eigen::Index begin, Eigen::Index end, Update &&update) {
+    using Packet = typename Eigen::internal::packet_traits<T>::type;
+    constexpr Eigen::Index PS = Eigen::internal::packet_traits<T>::size;
+    Eigen::Index i = begin;
+    for (; i + PS <= end; i += PS) update(Packet(), i);
+    for (; i < end; ++i) update(T(), i);
+}
+
+// kernel(begin, end) over [0, size), threaded once each thread gets OPTIMIZER_GRAIN elements
+template <typename Kernel>
+void optimizer_pass(Eigen::Index size, Kernel &&kernel) {
+    const Eigen::Index threads = std::min<Eigen::Index>(get_num_threads(), std::max<Eigen::Index>(1, size / OPTIMIZER_GRAIN));
+    parallel_for(size, kernel, int(threads));
+}
+
+template <typename T>
+class Optimizer {
+public:
+    virtual ~Optimizer() = default;
+
+    // Updates every parameter of the arena from its gradient, then zeroes the gradients
+    virtual void step(ParameterArena<T> &arena) = 0;
+
+protected:
+    // Optimizer state matching the arena; parameters added later start from zero state
+    static void match(std::vector<T> &state, const ParameterArena<T> &arena) {
+        if (Eigen::Index(state.size()) != arena.size()) state.resize(arena.size(), T(0));
+    }
+};
+
+template <typename T>
+class SGDMomentum : public Optimizer<T> {
+public:
+    T learning_rate, momentum, weight_decay;
+    bool nesterov;
+
+    explicit SGDMomentum(T learning_rate, T momentum = T(0.9), T weight_decay = T(0), bool nesterov = false)
+        : learning_rate(learning_rate), momentum(momentum), weight_decay(weight_decay), nesterov(nesterov) {}
+
+    void step(ParameterArena<T> &arena) override {
+        this->match(velocity_, arena);
+        T *p = arena.values(), *g = arena.grads(), *v = velocity_.data();
+        // p -= lr * (look * v + keep * g)
+        const T lr = learning_rate, mu = momentum, decay = weight_decay;
+        const T look = nesterov ? momentum : T(1), keep = nesterov ? T(1) : T(0);
+
+        optimizer_pass(arena.size(), [=](Eigen::Index begin, Eigen::Index end) {
+            using namespace Eigen::internal;
+            packet_loop<T>(begin, end, [=](auto packet, Eigen::Index i) {
+                using P = decltype(packet);
+                const P param = ploadu<P>(p + i);
+                const P grad = pmadd(pset1<P>(decay), param, ploadu<P>(g + i));
+                const P vel = pmadd(pset1<P>(mu), ploadu<P>(v + i), grad);
+                const P direction = pmadd(pset1<P>(look), vel, pmul(pset1<P>(keep), grad));
+                pstoreu(v + i, vel);
+                pstoreu(p + i, psub(param, pmul(pset1<P>(lr), direction)));
+                pstoreu(g + i, pset1<P>(T(0)));
+            });
+        });
+    }
+
+private:
+    std::vector<T> velocity_;
+};
+
+template <typename T>
+class Adam : public Optimizer<T> {
+public:
+    T learning_rate, beta1, beta2, epsilon, weight_decay;
+
+    explicit Adam(T learning_rate = T(1e-3), T beta1 = T(0.9), T beta2 = T(0.999), T epsilon = T(1e-8), T weight_decay = T(0))
+        : learning_rate(learning_rate), beta1(beta1), beta2(beta2), epsilon(epsilon), weight_decay(weight_decay) {}
+
+    void step(ParameterArena<T> &arena) override {
+        this->match(m_, arena);
+        this->match(v_, arena);
+        ++t_;
+        T *p = arena.values(), *g = arena.grads(), *m = m_.data(), *v = v_.data();
+        const T b1 = beta1, b2 = beta2;
+        const T correction = std::sqrt(T(1) - std::pow(b2, T(t_)));
+        const T step_size = learning_rate * correction / (T(1) - std::pow(b1, T(t_)));
+        const T eps = epsilon * correction;
+        const T l2 = decoupled() ? T(0) : weight_decay;
+        const T shrink = decoupled() ? T(1) - learning_rate * weight_decay : T(1);
+
+        optimizer_pass(arena.size(), [=](Eigen::Index begin, Eigen::Index end) {
+            using namespace Eigen::internal;
+            packet_loop<T>(begin, end, [=](auto packet, Eigen::Index i) {
+                using P = decltype(packet);
+                const P param = ploadu<P>(p + i);
+                const P grad = pmadd(pset1<P>(l2), param, ploadu<P>(g + i));
+                const P first = pmadd(pset1<P>(b1), ploadu<P>(m + i), pmul(pset1<P>(T(1) - b1), grad));
+                const P second = pmadd(pset1<P>(b2), ploadu<P>(v + i), pmul(pset1<P>(T(1) - b2), pmul(grad, grad)));
+                const P update = pdiv(pmul(pset1<P>(step_size), first), padd(psqrt(second), pset1<P>(eps)));
+                pstoreu(m + i, first);
+                pstoreu(v + i, second);
+                pstoreu(p + i, psub(pmul(param, pset1<P>(shrink)), update));
+                pstoreu(g + i, pset1<P>(T(0)));
+            });
+        });
+    }
+
+    long steps() const { return t_; }
+
+protected:
+    // AdamW: weight decay applied to the parameters, not the gradient
+    virtual bool decoupled() const { return false; }
+
+private:
+    std::vector<T> m_, v_;
+    long t_ = 0;
+};
+
+template <typename T>
+class AdamW : public Adam<T> {
+public:
+    explicit AdamW(T learning_rate = T(1e-3), T beta1 = T(0.9), T beta2 = T(0.999), T epsilon = T(1e-8), T weight_decay = T(1e-2))
+        : Adam<T>(learning_rate, beta1, beta2, epsilon, weight_decay) {}
+
+protected:
+    bool decoupled() const override { return true; }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
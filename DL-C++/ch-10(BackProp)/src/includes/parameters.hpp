@@ -0,0 +1,107 @@
+#ifndef __MY_PARAMETERS__
+#define __MY_PARAMETERS__
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <new>
+#include <vector>
+#include "activations.hpp"
+
+/*
+    Every trainable tensor of a model lives in one ParameterArena: all values
+    back to back in one flat buffer, all gradients at the same offsets in a
+    second one. Optimizers then update the whole model in one pass over
+    contiguous memory (see optimizers.hpp) instead of a call per tensor, and
+    zeroing, copying or reducing every gradient is a single flat loop.
+
+    A Parameter is a view, rows x cols at an offset into the arena. Its maps
+    are built on every value() / grad() call, so adding a parameter (which
+    may move the buffers) leaves existing Parameter references valid; maps
+    and pointers taken before the add do not survive it.
+
+    Both buffers start on a cache line (ARENA_ALIGNMENT), so code that
+    partitions the arena by cache line, like the Hogwild update, sees the
+    same lines as the hardware.
+*/
+
+constexpr std::size_t ARENA_ALIGNMENT = 64;
+
+// std::allocator with ARENA_ALIGNMENT-aligned blocks
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(std::size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(ARENA_ALIGNMENT))); }
+    void deallocate(T *p, std::size_t) { ::operator delete(p, std::align_val_t(ARENA_ALIGNMENT)); }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &) const { return false; }
+};
+
+template <typename T>
+class ParameterArena;
+
+template <typename T>
+class Parameter {
+public:
+    using Map = Eigen::TensorMap<Tensor<T, 2>>;
+
+    Map value() const { return Map(arena_->values() + offset_, rows_, cols_); }
+    Map grad() const { return Map(arena_->grads() + offset_, rows_, cols_); }
+    void zero_grad() const { std::fill(arena_->grads() + offset_, arena_->grads() + offset_ + size(), T(0)); }
+
+    Eigen::Index rows() const { return rows_; }
+    Eigen::Index cols() const { return cols_; }
+    Eigen::Index size() const { return rows_ * cols_; }
+    Eigen::Index offset() const { return offset_; }
+
+private:
+    friend class ParameterArena<T>;
+
+    Parameter(ParameterArena<T> *arena, Eigen::Index offset, Eigen::Index rows, Eigen::Index cols)
+        : arena_(arena), offset_(offset), rows_(rows), cols_(cols) {}
+
+    ParameterArena<T> *arena_;
+    Eigen::Index offset_, rows_, cols_;
+};
+
+template <typename T>
+class ParameterArena {
+public:
+    ParameterArena() = default;
+    ParameterArena(const ParameterArena &) = delete;
+    ParameterArena &operator=(const ParameterArena &) = delete;
+
+    // A zero-initialised rows x cols parameter at the end of the arena
+    Parameter<T> &add(Eigen::Index rows, Eigen::Index cols) {
+        if (rows <= 0 || cols <= 0) throw std::invalid_argument("ParameterArena: empty parameter");
+        const Eigen::Index offset = size();
+        values_.resize(offset + rows * cols, T(0));
+        grads_.resize(offset + rows * cols, T(0));
+        parameters_.push_back(Parameter<T>(this, offset, rows, cols));
+        return parameters_.back();
+    }
+
+    T *values() { return values_.data(); }
+    const T *values() const { return values_.data(); }
+    T *grads() { return grads_.data(); }
+    const T *grads() const { return grads_.data(); }
+    Eigen::Index size() const { return Eigen::Index(values_.size()); }
+
+    void zero_grad() { std::fill(grads_.begin(), grads_.end(), T(0)); }
+
+    std::deque<Parameter<T>> &parameters() { return parameters_; }
+
+private:
+    std::vector<T, ArenaAllocator<T>> values_, grads_;
+    std::deque<Parameter<T>> parameters_;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef __MY_TRAINER__
+#define __MY_TRAINER__
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "autograd.hpp"
+#include "optimizers.hpp"
+#include "parallel.hpp"
+
+/*
+    Data-parallel training on shared memory.
+
+    step() splits the mini-batch into one contiguous shard of rows per
+    worker. Each worker records the model on its own tape and runs forward
+    and backward on its shard, reading the shared parameter values but
+    accumulating parameter gradients into a private arena-sized buffer
+    (Tape::redirect_gradients()), so workers never write the same memory.
+    Its backward is seeded with shard / batch, which makes the sum of the
+    worker gradients the gradient of the mean loss over the whole batch.
+
+    The worker buffers are then reduced into the arena's gradient buffer:
+    the arena is split into one contiguous range per thread (a
+    reduce-scatter; nothing has to be gathered back, memory is shared), and
+    each range is summed over the workers tile by tile, a pairwise tree per
+    tile:
+        level 1:  g0 += g1, g2 += g3, ...
+        level 2:  g0 += g2, g4 += g6, ...
+    A tile of every worker buffer stays in cache through all log2(workers)
+    levels, and each source tile is zeroed right after it is added, ready
+    for the next step. The optimizer then updates the arena in one pass.
+
+    Shards, tree order and tiles only depend on the batch size and the
+    worker count, so a run is bitwise reproducible for a fixed worker count.
+    Different counts agree up to float rounding.
+*/
+
+// Elements per reduction tile: a tile of each worker buffer (16 KB in float) stays in L2 across the tree
+constexpr Eigen::Index REDUCE_TILE = 4096;
+
+// Builds a model's 1 x 1 mean loss on X (rows are samples) against TRUE
+template <typename T>
+using LossFunction = std::function<Var<T>(Tape<T> &, const Tensor<T, 2> &, const Tensor<T, 2> &)>;
+
+template <typename T>
+class DataParallelTrainer {
+public:
+    DataParallelTrainer(ParameterArena<T> &arena, LossFunction<T> loss, Optimizer<T> &optimizer, int workers = get_num_threads())
+        : arena_(arena), loss_(std::move(loss)), optimizer_(optimizer) {
+        if (workers < 1) throw std::invalid_argument("DataParallelTrainer: needs at least one worker");
+        for (int w = 0; w < workers; ++w) workers_.push_back(std::make_unique<Worker>());
+    }
+
+    // One optimizer step on the mean loss over X; returns that loss
+    T step(const Tensor<T, 2> &X, const Tensor<T, 2> &TRUE) {
+        if (X.dimension(0) != TRUE.dimension(0)) throw std::invalid_argument("DataParallelTrainer: X and TRUE batch sizes differ");
+        const Eigen::Index batch = X.dimension(0), count = workers();
+        for (auto &worker : workers_) {
+            if (Eigen::Index(worker->grads.size()) != arena_.size()) worker->grads.assign(arena_.size(), T(0));
+        }
+
+        parallel_for(count, [&](Eigen::Index begin, Eigen::Index end) {
+            for (Eigen::Index w = begin; w < end; ++w) run(*workers_[w], X, TRUE, w * batch / count, (w + 1) * batch / count);
+        }, int(count));
+        reduce();
+        optimizer_.step(arena_);
+
+        T loss = T(0);
+        for (const auto &worker : workers_) loss += worker->loss;
+        return loss;
+    }
+
+    Eigen::Index workers() const { return Eigen::Index(workers_.size()); }
+
+private:
+    struct Worker {
+        Tape<T> tape;
+        std::vector<T> grads;    // arena-sized, zero between steps
+        Tensor<T, 2> X, TRUE;    // this worker's shard
+        T loss = T(0);           // shard mean loss * shard / batch
+    };
+
+    void run(Worker &worker, const Tensor<T, 2> &X, const Tensor<T, 2> &TRUE, Eigen::Index begin, Eigen::Index end) {
+        worker.loss = T(0);
+        if (begin == end) return;
+        const Eigen::Index rows = end - begin;
+        worker.X = X.slice(Eigen::array<Eigen::Index, 2>{begin, 0}, Eigen::array<Eigen::Index, 2>{rows, X.dimension(1)});
+        worker.TRUE = TRUE.slice(Eigen::array<Eigen::Index, 2>{begin, 0}, Eigen::array<Eigen::Index, 2>{rows, TRUE.dimension(1)});
+
+        const T share = T(rows) / T(X.dimension(0));
+        worker.tape.clear();
+        worker.tape.redirect_gradients(worker.grads.data());
+        const Var<T> loss = loss_(worker.tape, worker.X, worker.TRUE);
+        worker.loss = share * worker.tape.value(loss)(0, 0);
+        worker.tape.backward(loss, share);
+    }
+
+    // arena gradients += sum of the worker buffers, which are left zeroed
+    void reduce() {
+        using Array = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+        const Eigen::Index size = arena_.size(), count = workers();
+        const Eigen::Index threads = std::min<Eigen::Index>(count, std::max<Eigen::Index>(1, size / OPTIMIZER_GRAIN));
+
+        parallel_for(size, [&](Eigen::Index begin, Eigen::Index end) {
+            for (Eigen::Index tile = begin; tile < end; tile += REDUCE_TILE) {
+                const Eigen::Index length = std::min(REDUCE_TILE, end - tile);
+                auto part = [&](Eigen::Index w) { return Array(workers_[w]->grads.data() + tile, length); };
+                for (Eigen::Index stride = 1; stride < count; stride *= 2) {
+                    for (Eigen::Index w = 0; w + stride < count; w += 2 * stride) {
+                        part(w) += part(w + stride);
+                        part(w + stride).setZero();
+                    }
+                }
+                Array(arena_.grads() + tile, length) += part(0);
+                part(0).setZero();
+            }
+        }, int(threads));
+    }
+
+    ParameterArena<T> &arena_;
+    LossFunction<T> loss_;
+    Optimizer<T> &optimizer_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+#endif
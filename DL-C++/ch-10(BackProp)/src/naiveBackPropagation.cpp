@@ -1,96 +1,221 @@
-#include <unsupported/Eigen/CXX11/Tensor>
+#include <chrono>
+#include <iostream>
+#include <tuple>
+#include "includes/activations.hpp"
+#include "includes/optimizers.hpp"
+
+/*
+    Backpropagation through a three-layer perceptron, written out by hand:
+        Z0 = X W0,  Y0 = ReLU(Z0)
+        Z1 = Y0 W1, Y1 = ReLU(Z1)
+        Z2 = Y1 W2, Y2 = softmax(Z2),   C = categorical cross-entropy(TRUE, Y2)
+
+    gradient() turns a layer's dC/dY into dC/dZ, dC/dW and the upstream
+    dC/dY. Elementwise activations take the Hadamard-product path and
+    softmax its O(n) vector-Jacobian product (see activations.hpp); the
+    batch x n x n Jacobian with a batched matrix multiplication is kept as
+    gradient_jacobian() to check against and to time.
+
+    The weights live in a ParameterArena; loop() writes the three gradients
+    into it and lets an optimizer update all of them in one fused pass.
+*/
+
 template <typename T>
+using Tensor2 = Tensor<T, 2>;
 
+// A layer's weights, viewed in place in the parameter arena
+template <typename T>
+using Weights = typename Parameter<T>::Map;
+
+const Eigen::array<Eigen::IndexPair<int>, 1> PRODUCT_DIMS = {Eigen::IndexPair<int>(1, 0)};      // A B
+const Eigen::array<Eigen::IndexPair<int>, 1> TRANSPOSE_A_DIMS = {Eigen::IndexPair<int>(0, 0)};  // A^T B
+const Eigen::array<Eigen::IndexPair<int>, 1> TRANSPOSE_B_DIMS = {Eigen::IndexPair<int>(1, 1)};  // A B^T
 
-// forward pass
 template <typename T>
-auto forward(const Tensor<T, 2> &X, const Tensor<T, 2> &W0, const Tensor<T, 2> &W1, const Tensor<T, 2> &W2){
+struct CategoricalCrossEntropy {
+    static constexpr T EPSILON = T(1e-7);
+
+    // Mean over the batch of -sum_i true_i log(y_i)
+    T evaluate(const Tensor2<T> &TRUE, const Tensor2<T> &y) const {
+        const Eigen::Tensor<T, 0> total = (TRUE * y.cwiseMax(EPSILON).log()).sum();
+        return -total() / T(y.dimension(0));
+    }
 
-    const array<IndexPair<T>, 1> contract_dims = {IndexPair<T>(1, 0)};
-    
+    // dC/dY per sample; the 1 / batch of the mean is applied to the weight gradients
+    Tensor2<T> derivative(const Tensor2<T> &TRUE, const Tensor2<T> &y) const { return -TRUE / y.cwiseMax(EPSILON); }
+};
+
+// forward pass
+template <typename T>
+auto forward(const Tensor2<T> &X, const Weights<T> &W0, const Weights<T> &W1, const Weights<T> &W2) {
+    RELU<T> relu;
+    Softmax<T> softmax;
 
     // first hidden layer
-    RELU relu;
-    Tensor<T, 2> Z0 = X.contract(W0, contract_dims); // X.W0
-    Tensor<T, 2> Y0 = relu.evaluate(Z0); // ReLU(X.W0)
+    Tensor2<T> Z0 = X.contract(W0, PRODUCT_DIMS);    // X.W0
+    Tensor2<T> Y0 = relu.evaluate(Z0);                // ReLU(X.W0)
 
     // second hidden layer
-    Tensor<T, 2> Z1 = Y0.contract(W1, contract_dims); // Y0.W1
-    Tensor<T, 2> Y1 = relu.evaluate(Z1); // ReLU(Y0.W1)
+    Tensor2<T> Z1 = Y0.contract(W1, PRODUCT_DIMS);   // Y0.W1
+    Tensor2<T> Y1 = relu.evaluate(Z1);                // ReLU(Y0.W1)
 
     // output layer
-    Tensor<T, 2> Z2 = Y1.contract(W2, contract_dims); // Y1.W2
-    Tensor<T, 2> Y2 = softmax.evaluate(Z2); // softmax(Y1.W2)
+    Tensor2<T> Z2 = Y1.contract(W2, PRODUCT_DIMS);   // Y1.W2
+    Tensor2<T> Y2 = softmax.evaluate(Z2);             // softmax(Y1.W2)
 
     return std::make_tuple(Z0, Z1, Z2, Y0, Y1, Y2);
 }
 
-auto gradient(const Tensor<T, 2> &dc_dy, cont Tensor<T, 2> &input, const Tensor<T, 2> &z, const Tensor<T, 2> &y, const Tensor<T, 2> &w, const Activation &activation, const bool propagate = true){
-    const int batch_size = input.dimension(0);
-    //calculating dy_dz
-    Tensor<float, 3> dy_dz = activation.jacobian(z);
-
-    //reshaping dc_dy to 3d to meet bmm
-    const array<Index, 3> dc_dy_3d_dim = {batch_size, 1, Y.dimension(1)};
-    Tensor<float, 3> dc_dy_3d = dc_dy.reshape(dc_dy_3d_dim);
-
-    //calculating dc_dz using batched matrix multiplication
-    Tensor<float, 3> dc_dz = batched_matrix_multiplication(dc_dy_3d, dy_dz);
-
-    //calculating dc_dw
-    const array<IndexPair<T>, 1> product_dims_0_0 = {IndexPair<T>(0, 0)};
-    const array<Index, 2> dc_dw_dim = {w.dimension(0), w.dimension(1)};
-    Tensor<T, 2> dc_dw = input.contract(dc_dz, product_dims_0_0).reshape(dc_dw_dim);
-    Tensor<float, 2> grad = dc_dw/dc_dw.constant(batch_size);
-
-    Tensor<flaot, 2> downstream;
-    if(propagate){
-        //flase only for the first hidden layer
-        //calculating the error propagation dc_dy for the previous layer
-        const array<IndexPair<T>, 2> error_propagation_dims = {batch_size, input.dimension(1)};
-        const array<IndexPair<T>, 1> product_dims_2_1 = {IndexPair<T>(2, 1)};
-        downstream = dc_dz.contract(dy_dz, error_propagation_dims).contract(product_dims_2_1);
-    }
-    return std::make_tuple(grad, downstream);
+// dC/dW of a layer and, when propagate is set, the dC/dY of the layer below
+template <typename T>
+auto weight_gradients(const Tensor2<T> &dc_dz, const Tensor2<T> &input, const Weights<T> &w, bool propagate) {
+    const Tensor2<T> dc_dw = input.contract(dc_dz, TRANSPOSE_A_DIMS);
+    Tensor2<T> grad = dc_dw / dc_dw.constant(T(input.dimension(0)));
 
+    Tensor2<T> downstream;
+    if (propagate) downstream = dc_dz.contract(w, TRANSPOSE_B_DIMS);
+    return std::make_tuple(grad, downstream);
 }
 
 template <typename T>
-auto backward(cosnt Tensor<T, 2> &TRUE, const Tensor<T, 2> &x, const Tensor<T, 2> &z0, const Tensor<T, 2> &z1, const Tensor<T, 2> &z2, const Tensor<T, 2> &y0, const Tensor<T, 2> &y1, const Tensor<T, 2> &y2, const Tensor<T, 2> &w0, const Tensor<T, 2> &w1, const Tensor<T, 2> &w2){
-    
+auto gradient(const Tensor2<T> &dc_dy, const Tensor2<T> &input, const Tensor2<T> &z, const Tensor2<T> &y,
+              const Weights<T> &w, const Activation<T> &activation, const bool propagate = true) {
+    // Diagonal Jacobian: Hadamard product with the derivative; otherwise the activation's VJP
+    const Tensor2<T> dc_dz = activation.elementwise() ? Tensor2<T>(dc_dy * activation.derivative(z, y))
+                                                      : activation.vjp(dc_dy, z, y);
+    return weight_gradients(dc_dz, input, w, propagate);
 }
 
+// out[b] = a[b] (1 x n) * m[b] (n x n)
+template <typename T>
+Tensor<T, 3> batched_matrix_multiplication(const Tensor<T, 3> &a, const Tensor<T, 3> &m) {
+    Tensor<T, 3> out(a.dimension(0), a.dimension(1), m.dimension(2));
+    for (Eigen::Index b = 0; b < a.dimension(0); ++b) {
+        out.chip(b, 0) = a.chip(b, 0).contract(m.chip(b, 0), PRODUCT_DIMS);
+    }
+    return out;
+}
 
+// The same gradient through the full batch x n x n Jacobian (reference)
+template <typename T>
+auto gradient_jacobian(const Tensor2<T> &dc_dy, const Tensor2<T> &input, const Tensor2<T> &z, const Tensor2<T> &y,
+                       const Weights<T> &w, const Activation<T> &activation, const bool propagate = true) {
+    const Eigen::Index batch_size = input.dimension(0), n = y.dimension(1);
+    const Tensor<T, 3> dy_dz = activation.jacobian(z, y);
+    const Tensor<T, 3> dc_dy_3d = dc_dy.reshape(Eigen::array<Eigen::Index, 3>{batch_size, 1, n});
+    const Tensor2<T> dc_dz = batched_matrix_multiplication(dc_dy_3d, dy_dz).reshape(Eigen::array<Eigen::Index, 2>{batch_size, n});
+    return weight_gradients(dc_dz, input, w, propagate);
+}
 
+template <typename T>
+auto backward(const Tensor2<T> &TRUE, const Tensor2<T> &x, const Tensor2<T> &z0, const Tensor2<T> &z1,
+              const Tensor2<T> &z2, const Tensor2<T> &y0, const Tensor2<T> &y1, const Tensor2<T> &y2,
+              const Weights<T> &w0, const Weights<T> &w1, const Weights<T> &w2) {
+    RELU<T> relu;
+    Softmax<T> softmax;
+    CategoricalCrossEntropy<T> cost_fn;
+
+    auto [grad2, dc_dy1] = gradient(cost_fn.derivative(TRUE, y2), y1, z2, y2, w2, softmax);
+    auto [grad1, dc_dy0] = gradient(dc_dy1, y0, z1, y1, w1, relu);
+    auto [grad0, unused] = gradient(dc_dy0, x, z0, y0, w0, relu, false);
+    return std::make_tuple(grad0, grad1, grad2);
+}
 
+// One training step on the three layers' weights, all held in arena
+template <typename T>
+T loop(const Tensor2<T> &TRUE, const Tensor2<T> &X, ParameterArena<T> &arena, const Parameter<T> &W0,
+       const Parameter<T> &W1, const Parameter<T> &W2, Optimizer<T> &optimizer) {
+    //forward pass
+    auto [Z0, Z1, Z2, Y0, Y1, Y2] = forward(X, W0.value(), W1.value(), W2.value());
 
+    //Output Cost
+    CategoricalCrossEntropy<T> cost_fn;
+    T LOSS = cost_fn.evaluate(TRUE, Y2);
 
+    //backward pass
+    auto [grad0, grad1, grad2] = backward(TRUE, X, Z0, Z1, Z2, Y0, Y1, Y2, W0.value(), W1.value(), W2.value());
+    W0.grad() = grad0;
+    W1.grad() = grad1;
+    W2.grad() = grad2;
 
+    //UPDATE PASS: every weight of the arena in one pass
+    optimizer.step(arena);
 
+    return LOSS;
+}
 
+template <typename T>
+T max_abs_diff(const Tensor2<T> &a, const Tensor2<T> &b) {
+    const Eigen::Tensor<T, 0> diff = (a - b).abs().maximum();
+    return diff();
+}
 
+template <typename Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
 
+int main() {
+    // Three Gaussian blobs in 4-D, one-hot labels
+    const Eigen::Index batch = 96, features = 4, hidden = 16, classes = 3;
+    Tensor2<float> X(batch, features), TRUE(batch, classes);
+    X.setRandom<Eigen::internal::NormalRandomGenerator<float>>();
+    TRUE.setZero();
+    for (Eigen::Index b = 0; b < batch; ++b) {
+        const Eigen::Index label = b % classes;
+        TRUE(b, label) = 1.f;
+        X(b, label) += 3.f;
+    }
 
+    ParameterArena<float> arena;
+    const Parameter<float> &W0 = arena.add(features, hidden), &W1 = arena.add(hidden, hidden), &W2 = arena.add(hidden, classes);
+    for (const Parameter<float> *w : {&W0, &W1, &W2}) {
+        w->value().setRandom<Eigen::internal::NormalRandomGenerator<float>>();
+        w->value() = w->value() * w->value().constant(1.f / std::sqrt(float(w->rows())));
+    }
 
+    // Both gradient paths on every layer
+    {
+        auto [Z0, Z1, Z2, Y0, Y1, Y2] = forward(X, W0.value(), W1.value(), W2.value());
+        RELU<float> relu;
+        Softmax<float> softmax;
+        const Tensor2<float> dc_dy2 = CategoricalCrossEntropy<float>().derivative(TRUE, Y2);
+        auto [g2, d1] = gradient(dc_dy2, Y1, Z2, Y2, W2.value(), softmax);
+        auto [j2, e1] = gradient_jacobian(dc_dy2, Y1, Z2, Y2, W2.value(), softmax);
+        auto [g1, d0] = gradient(d1, Y0, Z1, Y1, W1.value(), relu);
+        auto [j1, e0] = gradient_jacobian(d1, Y0, Z1, Y1, W1.value(), relu);
+        std::cout << "Hadamard/VJP against Jacobian path, max |diff|: softmax layer dW " << max_abs_diff(g2, j2)
+                  << ", dY " << max_abs_diff(d1, e1) << "; ReLU layer dW " << max_abs_diff(g1, j1) << ", dY "
+                  << max_abs_diff(d0, e0) << std::endl;
+    }
 
+    std::cout << std::endl << "Training (SGD, learning rate 0.5)" << std::endl;
+    SGDMomentum<float> sgd(0.5f, 0.f);
+    for (int epoch = 0; epoch <= 200; ++epoch) {
+        const float loss = loop(TRUE, X, arena, W0, W1, W2, sgd);
+        if (epoch % 40 == 0) std::cout << "epoch " << epoch << ": loss " << loss << std::endl;
+    }
 
-// simple four-layer neuron
-T loop(const Tensor<T, 2>& &TRUE, const Tensor<T, 2>& &X, const Tensor<T, 2> &W0, const Tensor<T, 2> &W1, const Tensor<T, 2> &W2, const T learning_rate){
-    
-    //forward pass
-    auto [Z0, Z1, Z2, Y0, Y1, Y2] = forward(X, W0, W1, W2);
-
-    //Output Cost
-    CategoricalCrossEntropy cost_fn;
-    T LOSS = cost_fn.evaluate( TRUE, Y2);
-
-    //backward pass
-    auto [grad0, grad1, grad2] = backward(TRUE, X,Z0,Z1,Z2,Y0,Y1,Y2,W0,W1,W2);
-
-
-    //UPDATE PASS
-    update(W0, W1, W2, grad0, grad1, grad2, learning_rate);
-
-    return LOSS;
+    // One ReLU layer's backward step, batch 32: elementwise path against the Jacobian path
+    std::cout << std::endl << "ReLU layer backward, batch 32" << std::endl;
+    RELU<float> relu;
+    for (Eigen::Index n : {256, 1024}) {
+        Tensor2<float> input(32, n), weights(n, n), dc_dy(32, n);
+        input.setRandom();
+        weights.setRandom();
+        const Weights<float> w(weights.data(), n, n);
+        dc_dy.setRandom();
+        const Tensor2<float> z = input.contract(w, PRODUCT_DIMS) - input.contract(w, PRODUCT_DIMS).constant(0.5f * n);
+        const Tensor2<float> y = relu.evaluate(z);
+        const double elementwise_ms = time_ms([&] { gradient(dc_dy, input, z, y, w, relu); });
+        const double jacobian_ms = time_ms([&] { gradient_jacobian(dc_dy, input, z, y, w, relu); });
+        std::cout << "n = " << n << ": Hadamard " << elementwise_ms << " ms, Jacobian " << jacobian_ms << " ms ("
+                  << 32.0 * n * n * sizeof(float) / (1024 * 1024) << " MB Jacobian)" << std::endl;
+    }
+    std::cout << "n = 4096: the Jacobian would take " << 32.0 * 4096 * 4096 * sizeof(float) / (1024 * 1024 * 1024)
+              << " GB, the derivative " << 32.0 * 4096 * sizeof(float) / 1024 << " KB" << std::endl;
+    return 0;
 }
-
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "utils/Eigen/Core"
+#include "includes/convolution.hpp"
 
 
 using Matrix = Eigen::MatrixXd;
@@ -25,22 +26,11 @@ int main(){
     std::cout << "Input:\n" << input << "\n\n";
 
 
-    auto Conv_2D = [](const Matrix& input, const Matrix& kernel) {
-        int kRows = kernel.rows();
-        int kCols = kernel.cols();
-        int iRows = input.rows();
-        int iCols = input.cols();
-        Matrix output(iRows - kRows + 1, iCols - kCols + 1);
+    // im2col + GEMM engine; the kernel is prepared once and reused per call
+    Convolution2D<double> Conv_2D(kernel);
+    std::cout << "Kernel rank " << Conv_2D.rank() << (Conv_2D.separable() ? ": runs as two 1-D passes" : "") << "\n\n";
 
-        for (int i = 0; i <= iRows - kRows; ++i) {
-            for (int j = 0; j <= iCols - kCols; ++j) {
-                output(i, j) = (input.block(i, j, kRows, kCols).array() * kernel.array()).sum();
-            }
-        }
-        return output;
-    };
-
-    auto output = Conv_2D(input, kernel);
+    auto output = Conv_2D(input);
     std::cout << "Convolution:\n" << output << "\n";
 
     return 0;
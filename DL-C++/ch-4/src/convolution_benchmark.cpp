@@ -0,0 +1,123 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "utils/Eigen/Core"
+#include "includes/convolution.hpp"
+
+/*
+    Block-loop Conv_2D (the original convolution_2d_example.cpp version)
+    against the im2col + GEMM engine, in float and double, on 224x224 and
+    1024x1024 inputs. Times are the best of a few runs.
+
+    The second table runs low-rank filters, which the engine executes as
+    1-D passes, against the same filters through im2col + GEMM.
+*/
+
+template <typename T>
+using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+template <typename T>
+Matrix<T> block_loop_conv(const Matrix<T> &input, const Matrix<T> &kernel) {
+    const Eigen::Index kRows = kernel.rows();
+    const Eigen::Index kCols = kernel.cols();
+    Matrix<T> output(input.rows() - kRows + 1, input.cols() - kCols + 1);
+    for (Eigen::Index i = 0; i < output.rows(); ++i) {
+        for (Eigen::Index j = 0; j < output.cols(); ++j) {
+            output(i, j) = (input.block(i, j, kRows, kCols).array() * kernel.array()).sum();
+        }
+    }
+    return output;
+}
+
+// The engine's im2col + GEMM path, whatever the kernel rank
+template <typename T>
+Matrix<T> im2col_conv(const Matrix<T> &input, const Matrix<T> &kernel) {
+    ConvGeometry g;
+    g.height = input.cols();
+    g.width = input.rows();
+    g.kernel_h = kernel.cols();
+    g.kernel_w = kernel.rows();
+    Matrix<T> output(g.out_w(), g.out_h());
+    std::vector<T> col(g.patch_size() * im2col_band_rows<T>(g) * g.out_w());
+    conv2d_im2col(input.data(), g, kernel.data(), 1, output.data(), col.data());
+    return output;
+}
+
+template <typename Fn>
+double best_time_ms(Fn &&fn, int repeats) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+template <typename T>
+void run(const std::string &type_name, Eigen::Index size, Eigen::Index k) {
+    Matrix<T> input = Matrix<T>::Random(size, size);
+    Matrix<T> kernel = Matrix<T>::Random(k, k);
+    Convolution2D<T> engine(kernel);
+
+    Matrix<T> reference, output;
+    const int repeats = size > 512 ? 3 : 10;
+    double loop_ms = best_time_ms([&] { reference = block_loop_conv(input, kernel); }, repeats);
+    double engine_ms = best_time_ms([&] { output = engine(input); }, repeats);
+
+    std::cout << std::setw(7) << type_name << std::setw(6) << size << std::setw(4) << k
+              << std::setw(12) << std::fixed << std::setprecision(2) << loop_ms
+              << std::setw(12) << engine_ms
+              << std::setw(10) << std::setprecision(1) << loop_ms / engine_ms << "x"
+              << std::setw(14) << std::scientific << std::setprecision(2) << (reference - output).cwiseAbs().maxCoeff()
+              << std::defaultfloat << "\n";
+}
+
+template <typename T>
+void run_low_rank(const std::string &name, const Matrix<T> &kernel, Eigen::Index size) {
+    Matrix<T> input = Matrix<T>::Random(size, size);
+    Convolution2D<T> engine(kernel);
+
+    Matrix<T> reference, output;
+    const int repeats = size > 512 ? 3 : 10;
+    double im2col_ms = best_time_ms([&] { reference = im2col_conv(input, kernel); }, repeats);
+    double engine_ms = best_time_ms([&] { output = engine(input); }, repeats);
+
+    std::cout << std::setw(14) << name << std::setw(6) << size << std::setw(6) << engine.rank()
+              << std::setw(13) << std::fixed << std::setprecision(2) << im2col_ms
+              << std::setw(10) << engine_ms
+              << std::setw(10) << std::setprecision(1) << im2col_ms / engine_ms << "x"
+              << std::setw(14) << std::scientific << std::setprecision(2) << (reference - output).cwiseAbs().maxCoeff()
+              << std::defaultfloat << "\n";
+}
+
+int main() {
+    std::cout << "   type  size   k  block (ms)  im2col (ms)  speedup   max |diff|\n";
+    for (Eigen::Index size : {224, 1024}) {
+        for (Eigen::Index k : {3, 5}) {
+            run<float>("float", size, k);
+            run<double>("double", size, k);
+        }
+    }
+
+    Matrix<float> sobel(3, 3);
+    sobel << -1, 0, 1, -2, 0, 2, -1, 0, 1;
+    Eigen::VectorXf binomial(5);
+    binomial << 1, 4, 6, 4, 1;
+    binomial /= 16;
+    const Matrix<float> gaussian = binomial * binomial.transpose();
+    const Matrix<float> box = Matrix<float>::Constant(7, 7, 1.f / 49);
+    const Matrix<float> rank2 = Eigen::VectorXf::Random(9) * Eigen::RowVectorXf::Random(9)
+                                + Eigen::VectorXf::Random(9) * Eigen::RowVectorXf::Random(9);
+
+    std::cout << "\n        filter  size  rank  im2col (ms)  1-D (ms)  speedup   max |diff|\n";
+    for (Eigen::Index size : {224, 1024}) {
+        run_low_rank<float>("sobel 3x3", sobel, size);
+        run_low_rank<float>("gaussian 5x5", gaussian, size);
+        run_low_rank<float>("box 7x7", box, size);
+        run_low_rank<float>("rank-2 9x9", rank2, size);
+    }
+    return 0;
+}
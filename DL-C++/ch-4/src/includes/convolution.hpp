@@ -0,0 +1,120 @@
+#ifndef __MY_CONVOLUTION__
+#define __MY_CONVOLUTION__
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/SVD>
+
+#include "im2col.hpp"
+
+/*
+    Single-channel convolution engine with the same contract as Conv_2D: valid
+    cross-correlation of an Eigen matrix with an Eigen kernel, for float or
+    double. The kernel is captured once at construction; the im2col buffer is
+    kept between calls so repeated calls on same-sized inputs do not allocate
+    it again (which also means one engine should not be shared by threads).
+
+    Eigen matrices are column-major, i.e. the buffer of an H x W matrix is the
+    row-major W x H image of its transpose. Since conv(X, K)^T = conv(X^T, K^T),
+    the engine runs on the transposed problem directly on the matrix buffers,
+    and the transposed output it writes row-major is the output read
+    column-major. Nothing is copied.
+
+    Low-rank kernels are detected at construction. A kernel of rank r is a
+    sum of r outer products u_t v_t^T (from its SVD, singular values below
+    the usual max(R, S) * epsilon * sigma_max cut-off counted as zero), and
+    each term is a vertical 1-D pass with u_t followed by a horizontal pass
+    with v_t: r * (R + S) multiplies per output instead of R * S. Box,
+    Gaussian and Sobel/Prewitt filters are rank 1. The passes are used when
+    they need fewer multiplies than the full kernel; both run down
+    contiguous matrix columns as vectorised axpys.
+*/
+template <typename T>
+class Convolution2D {
+public:
+    using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+    explicit Convolution2D(const Matrix &kernel_) : kernel(kernel_) {
+        if (kernel.size() == 0) throw std::invalid_argument("Empty convolution kernel");
+        factorize();
+    }
+
+    Matrix operator()(const Matrix &input) const {
+        if (input.rows() < kernel.rows() || input.cols() < kernel.cols()) throw std::invalid_argument("Input smaller than kernel");
+        if (separable()) return separable_convolution(input);
+
+        ConvGeometry g;
+        g.height = input.cols();
+        g.width = input.rows();
+        g.kernel_h = kernel.cols();
+        g.kernel_w = kernel.rows();
+
+        Matrix output(g.out_w(), g.out_h());
+        col.resize(g.patch_size() * im2col_band_rows<T>(g) * g.out_w());
+        conv2d_im2col(input.data(), g, kernel.data(), 1, output.data(), col.data());
+        return output;
+    }
+
+    const Matrix &weights() const { return kernel; }
+
+    // Numerical rank of the kernel, and whether it runs as 1-D passes
+    Eigen::Index rank() const { return kernel_rank; }
+    bool separable() const { return vertical.cols() != 0; }
+
+private:
+    void factorize() {
+        // Zero-padded to square, which has the same nonzero singular values and
+        // lets the two-sided Jacobi SVD run without a QR preconditioner
+        const Eigen::Index n = std::max(kernel.rows(), kernel.cols());
+        Eigen::MatrixXd k = Eigen::MatrixXd::Zero(n, n);
+        k.topLeftCorner(kernel.rows(), kernel.cols()) = kernel.template cast<double>();
+        Eigen::JacobiSVD<Eigen::MatrixXd, Eigen::NoQRPreconditioner> svd(k, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        svd.setThreshold(n * std::numeric_limits<T>::epsilon());
+        kernel_rank = svd.rank();
+        if (kernel_rank * (kernel.rows() + kernel.cols()) >= kernel.size()) return;
+
+        // K = sum_t (sigma_t u_t) v_t^T
+        vertical = (svd.matrixU().topLeftCorner(kernel.rows(), kernel_rank) * svd.singularValues().head(kernel_rank).asDiagonal()).template cast<T>();
+        horizontal = svd.matrixV().topLeftCorner(kernel.cols(), kernel_rank).template cast<T>();
+    }
+
+    Matrix separable_convolution(const Matrix &input) const {
+        const Eigen::Index R = kernel.rows(), S = kernel.cols();
+        const Eigen::Index out_rows = input.rows() - R + 1;
+        const Eigen::Index out_cols = input.cols() - S + 1;
+        Matrix output = Matrix::Zero(out_rows, out_cols);
+
+        // Output columns are done in strips whose vertical-pass buffer stays in L2
+        const Eigen::Index strip = std::clamp<Eigen::Index>(
+            IM2COL_BAND_BYTES / static_cast<Eigen::Index>(out_rows * sizeof(T)) - (S - 1), 1, out_cols);
+        Matrix pass(out_rows, strip + S - 1);
+
+        for (Eigen::Index j0 = 0; j0 < out_cols; j0 += strip) {
+            const Eigen::Index cols = std::min(strip, out_cols - j0);
+            for (Eigen::Index t = 0; t < kernel_rank; ++t) {
+                // pass(i, j) = sum_a u(a) input(i + a, j0 + j)
+                for (Eigen::Index j = 0; j < cols + S - 1; ++j) {
+                    const auto column = input.col(j0 + j);
+                    pass.col(j) = vertical(0, t) * column.head(out_rows);
+                    for (Eigen::Index a = 1; a < R; ++a) pass.col(j) += vertical(a, t) * column.segment(a, out_rows);
+                }
+                // output(i, j0 + j) += sum_b v(b) pass(i, j + b)
+                for (Eigen::Index j = 0; j < cols; ++j) {
+                    for (Eigen::Index b = 0; b < S; ++b) output.col(j0 + j) += horizontal(b, t) * pass.col(j + b);
+                }
+            }
+        }
+        return output;
+    }
+
+    Matrix kernel;
+    Eigen::Index kernel_rank = 0;
+    Matrix vertical;    // R x rank, columns sigma_t u_t
+    Matrix horizontal;  // S x rank, columns v_t
+    mutable std::vector<T> col;
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <functional>
 #include <stdexcept>
 
+#include "gemm.hpp"
+
 using Scalar = float;
 template <int Rank> using Tensor = Eigen::Tensor<Scalar, Rank>;
 using Tensor1D = Tensor<1>;
@@ -37,15 +39,14 @@ public:
         if (in_size != weight_dims[0]) throw std::invalid_argument("Input size mismatch");
         if (bias.dimension(0) != out_size) throw std::invalid_argument("Bias size mismatch");
 
-        Eigen::array<Eigen::IndexPair<int>, 1> contract_dims = {Eigen::IndexPair<int>(1, 0)};
-        Tensor2D prod = input.contract(weights, contract_dims);
-
-        DSizes<2> bias_shape{1, out_size};
-        auto bias_reshaped = bias.reshape(bias_shape);
-        DSizes<2> bcast{batch, 1};
-        Tensor2D bias_bcast = bias_reshaped.broadcast(bcast);
+        // Z = input * weights on the shared GEMM, then the bias added column by column
+        Tensor2D Z(batch, out_size);
+        gemm<Scalar>(false, false, batch, out_size, in_size, 1.f, input.data(), batch, weights.data(), in_size, 0.f, Z.data(), batch);
+        for (int j = 0; j < out_size; ++j) {
+            Scalar *column = Z.data() + static_cast<Eigen::Index>(j) * batch;
+            for (int i = 0; i < batch; ++i) column[i] += bias(j);
+        }
 
-        Tensor2D Z = prod + bias_bcast;
         return activation(Z);
     }
 
@@ -2,22 +2,11 @@
 #include <string>
 #include <exception>
 #include <iomanip>
+#include <cmath>
 
 #include <unsupported/Eigen/CXX11/Tensor>
 
-using TYPE = float;
-
-using Tensor_0D = Eigen::Tensor<TYPE, 0>;
-using Tensor_1D = Eigen::Tensor<TYPE, 1>;
-using Tensor_2D = Eigen::Tensor<TYPE, 2>;
-using Tensor_3D = Eigen::Tensor<TYPE, 3>;
-using Tensor_4D = Eigen::Tensor<TYPE, 4>;
-
-template<int _RANK>
-using Tensor = Eigen::Tensor<TYPE, _RANK>;
-
-template<int _RANK>
-using DimArray = Eigen::array<Eigen::DenseIndex, _RANK>;
+#include "includes/loss_functions.hpp"
 
 template <int _RANK>
 TYPE bce(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
@@ -25,8 +14,67 @@ TYPE bce(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
     auto COMP_PRED = PRED.constant(1.) - PRED;
     auto part1 = TRUE * (PRED + PRED.constant(1e-7)).log();
     auto part2 = COMP_TRUE * (COMP_PRED + COMP_PRED.constant(1e-7)).log();
-    auto parts = part1 + part2;
-    float sum = ((Tensor_0D)(parts.sum()))(0);
+    Tensor<_RANK> parts = part1 + part2;
+    float sum = deterministic_sum(parts);
     float result = -sum / PRED.size();
     return result;
-}
\ No newline at end of file
+}
+
+int main(int, char**)
+{
+    std::cout << std::fixed << std::setprecision(6);
+
+    // Raw scores of a 3-sample, 2-label binary classifier
+    Tensor_2D logits(3, 2);
+    logits.setValues({{ 2.5f, -1.0f},
+                      {-0.5f,  3.0f},
+                      {-4.0f,  0.2f}});
+
+    Tensor_2D labels(3, 2);
+    labels.setValues({{1.0f, 0.0f},
+                      {0.0f, 1.0f},
+                      {0.0f, 1.0f}});
+
+    // Two-step path: sigmoid, then BCE on probabilities
+    Tensor_2D probs = logits.unaryExpr([](float x) { return 1.f / (1.f + std::exp(-x)); });
+    float two_step = bce(probs, labels);
+
+    // One-step path: BCE straight from logits
+    float fused = bce_with_logits(logits, labels);
+
+    std::cout << "BCE(sigmoid(logits)): " << two_step << std::endl;
+    std::cout << "BCE with logits:      " << fused << std::endl << std::endl;
+
+    // Gradient w.r.t. the logits is simply (sigmoid(x) - y) / N
+    Tensor_2D grad(logits.dimensions());
+    bce_with_logits_value_and_grad(logits, labels, grad);
+    std::cout << "dLoss/dLogits:" << std::endl << grad << std::endl << std::endl;
+
+    // Up-weighting positives of the second label (e.g. a rare class)
+    Tensor_1D pos_weight(2);
+    pos_weight.setValues({1.0f, 3.0f});
+    std::cout << "BCE with logits, pos_weight [1, 3]: " << bce_with_logits(logits, labels, &pos_weight) << std::endl;
+
+    // Rank 1 with pos_weight: each row is a sample of its own class. Unit sample
+    // weights must give the flat loss and gradient back.
+    Tensor_1D flat_logits(4), flat_labels(4), flat_pos_weight(4), ones(4), row_loss(4), flat_grad(4), weighted_grad(4);
+    flat_logits.setValues({1.5f, -0.5f, 0.25f, -3.0f});
+    flat_labels.setValues({1.0f, 0.0f, 1.0f, 1.0f});
+    flat_pos_weight.setValues({1.0f, 2.0f, 0.5f, 4.0f});
+    ones.setConstant(1.0f);
+    float flat = bce_with_logits_value_and_grad(flat_logits, flat_labels, flat_grad, &flat_pos_weight);
+    float weighted = bce_with_logits_value_and_grad(flat_logits, flat_labels, weighted_grad, &flat_pos_weight, &ones, &row_loss);
+    Tensor_0D grad_diff = (flat_grad - weighted_grad).abs().maximum();
+    std::cout << "rank 1, pos_weight per row: flat " << flat << ", with unit sample weights " << weighted
+              << ", max |grad diff| " << grad_diff() << std::endl;
+    std::cout << "per-row losses: " << row_loss << std::endl;
+
+    // Saturated logits stay finite where the probability path would hit log(0)
+    Tensor_2D extreme(1, 2);
+    extreme.setValues({{100.0f, -100.0f}});
+    Tensor_2D wrong(1, 2);
+    wrong.setValues({{0.0f, 1.0f}});
+    std::cout << "BCE with logits, confidently wrong at |x| = 100: " << bce_with_logits(extreme, wrong) << std::endl;
+
+    return 0;
+}
@@ -6,25 +6,13 @@
 #include <cmath>
 #include <unsupported/Eigen/CXX11/Tensor>
 
-using TYPE = float;
-
-using Tensor_0D = Eigen::Tensor<TYPE, 0>;
-using Tensor_1D = Eigen::Tensor<TYPE, 1>;
-using Tensor_2D = Eigen::Tensor<TYPE, 2>;
-using Tensor_3D = Eigen::Tensor<TYPE, 3>;
-using Tensor_4D = Eigen::Tensor<TYPE, 4>;
-
-template<int _RANK>
-using Tensor = Eigen::Tensor<TYPE, _RANK>;
-
-template<int _RANK>
-using DimArray = Eigen::array<Eigen::DenseIndex, _RANK>;
+#include "includes/loss_accumulators.hpp"
 
 // Softmax activation function
 template <int _RANK>
-auto softmax(const Tensor<_RANK> &input) {
+Tensor<_RANK> softmax(const Tensor<_RANK> &input) {
     // Find max for numerical stability
-    auto max_val = input.maximum();
+    TYPE max_val = ((Tensor_0D)input.maximum())(0);
     
     // Subtract max and compute exp
     auto shifted = input - input.constant(max_val);
@@ -35,7 +23,7 @@ auto softmax(const Tensor<_RANK> &input) {
     TYPE sum_val = ((Tensor_0D)sum_exp)(0);
     
     // Normalize
-    auto result = exp_vals / exp_vals.constant(sum_val);
+    Tensor<_RANK> result = exp_vals / exp_vals.constant(sum_val);
     return result;
 }
 
@@ -48,10 +36,9 @@ auto categorical_cross_entropy(const Tensor<_RANK> &predictions, const Tensor<_R
     
     // Compute -sum(true_labels * log(predictions))
     auto log_preds = clipped_preds.log();
-    auto cross_entropy = true_labels * log_preds;
-    auto neg_sum = -cross_entropy.sum();
+    Tensor<_RANK> cross_entropy = true_labels * log_preds;
     
-    TYPE loss = ((Tensor_0D)neg_sum)(0);
+    TYPE loss = -deterministic_sum(cross_entropy);
     
     // Average over batch size (assuming first dimension is batch)
     if (_RANK > 1) {
@@ -162,5 +149,64 @@ int main(int, char**)
     std::cout << "- Higher confidence in wrong prediction = higher loss" << std::endl;
     std::cout << "- CCE heavily penalizes confident wrong predictions" << std::endl;
 
+    // Example 4: Loss and gradient from a single fused pass
+    std::cout << "\n=== Fused Loss and Gradient Example ===" << std::endl;
+
+    Tensor_2D grad_binary(good_pred_binary.dimensions());
+    float fused_loss_binary = categorical_cross_entropy_value_and_grad(good_pred_binary, true_binary, grad_binary);
+
+    std::cout << "CCE Loss (good, fused): " << fused_loss_binary << std::endl;
+    std::cout << "dLoss/dPred:" << std::endl;
+    std::cout << grad_binary << std::endl;
+
+    // Example 5: Dataset-level loss and accuracy from streamed batches
+    std::cout << "\n=== Streaming Accumulator Example ===" << std::endl;
+
+    CCEAccumulator stream_loss;
+    AccuracyAccumulator stream_accuracy;
+    for (const auto &[pred, truth] : {std::make_pair(good_pred_binary, true_binary),
+                                      std::make_pair(poor_pred_binary, true_binary),
+                                      std::make_pair(predictions_multi, true_multi)}) {
+        stream_loss.update(pred, truth);
+        stream_accuracy.update(pred, truth);
+    }
+
+    std::cout << "Samples seen: " << stream_loss.count() << std::endl;
+    std::cout << "Dataset CCE Loss: " << stream_loss.result() << std::endl;
+    std::cout << "Dataset accuracy: " << stream_accuracy.result() << std::endl;
+
+    // Example 6: Per-sample losses, sample weights and hard-example mining
+    std::cout << "\n=== Per-Sample Loss Example ===" << std::endl;
+
+    Tensor_2D mixed_pred(4, 3);
+    mixed_pred.setValues({{0.70f, 0.20f, 0.10f},    // right, fairly sure
+                          {0.10f, 0.30f, 0.60f},    // wrong
+                          {0.05f, 0.05f, 0.90f},    // right, very sure
+                          {0.34f, 0.33f, 0.33f}});  // right, barely
+    Tensor_2D mixed_true(4, 3);
+    mixed_true.setValues({{1.0f, 0.0f, 0.0f},
+                          {0.0f, 1.0f, 0.0f},
+                          {0.0f, 0.0f, 1.0f},
+                          {1.0f, 0.0f, 0.0f}});
+
+    Tensor_2D mixed_grad(mixed_pred.dimensions());
+    Tensor_1D sample_loss(4);
+    float batch_loss = categorical_cross_entropy_value_and_grad(mixed_pred, mixed_true, mixed_grad, nullptr, &sample_loss);
+
+    std::cout << "Batch CCE Loss: " << batch_loss << std::endl;
+    std::cout << "Per-sample loss: [";
+    for (int i = 0; i < 4; ++i) std::cout << sample_loss(i) << (i < 3 ? ", " : "]\n");
+
+    auto hardest = top_k_hardest(sample_loss, 2);
+    std::cout << "Two hardest samples: " << hardest[0] << ", " << hardest[1] << std::endl;
+
+    // Re-weight so the hard samples dominate the next update
+    Tensor_1D sample_weight(4);
+    sample_weight.setConstant(0.5f);
+    for (auto index : hardest) sample_weight(index) = 2.0f;
+
+    float weighted_loss = categorical_cross_entropy_value_and_grad(mixed_pred, mixed_true, mixed_grad, &sample_weight);
+    std::cout << "Weighted CCE Loss: " << weighted_loss << std::endl;
+
     return 0;
 }
\ No newline at end of file
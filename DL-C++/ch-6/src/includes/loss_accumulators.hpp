@@ -0,0 +1,163 @@
+#ifndef __MY_LOSS_ACCUMULATORS__
+#define __MY_LOSS_ACCUMULATORS__
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "loss_functions.hpp"
+
+/*
+    Streaming loss and metric accumulators.
+
+    Each accumulator keeps only the running (unnormalised) loss total and the
+    normaliser it will be divided by, so a dataset of any size can be fed in
+    mini-batches in constant memory. result() is the dataset-level value, not
+    a mean of batch means: feeding the data in one batch or in a thousand gives
+    the same number. Accumulators filled on different threads combine with
+    merge().
+*/
+
+// Kahan-compensated double, used for the running totals
+class CompensatedSum {
+public:
+    void add(double x) {
+        double y = x - comp;
+        double t = sum + y;
+        comp = (t - sum) - y;
+        sum = t;
+    }
+
+    void merge(const CompensatedSum &other) {
+        add(other.sum);
+        add(-other.comp);
+    }
+
+    double value() const { return sum - comp; }
+
+private:
+    double sum = 0.;
+    double comp = 0.;
+};
+
+// Policy-based accumulator: TERMS::total() returns the batch contribution to
+// the loss numerator and TERMS::normaliser() its contribution to the denominator.
+template <typename TERMS>
+class LossAccumulator {
+public:
+    template <int _RANK>
+    void update(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
+        if (PRED.dimensions() != TRUE.dimensions()) throw std::invalid_argument("Prediction/label shape mismatch");
+        total.add(TERMS::total(PRED, TRUE));
+        normaliser += TERMS::normaliser(PRED);
+    }
+
+    void merge(const LossAccumulator &other) {
+        total.merge(other.total);
+        normaliser += other.normaliser;
+    }
+
+    void reset() { *this = LossAccumulator(); }
+
+    int64_t count() const { return normaliser; }
+
+    TYPE result() const {
+        return normaliser == 0 ? 0.f : static_cast<TYPE>(total.value() / static_cast<double>(normaliser));
+    }
+
+private:
+    CompensatedSum total;
+    int64_t normaliser = 0;
+};
+
+struct MSETerms {
+    template <int _RANK>
+    static double total(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
+        return fused_loss_pass<MSEKernel, false>(PRED.data(), TRUE.data(), nullptr, PRED.size(), MSEKernel{0.f});
+    }
+
+    template <int _RANK>
+    static int64_t normaliser(const Tensor<_RANK> &PRED) { return PRED.size(); }
+};
+
+struct BCETerms {
+    template <int _RANK>
+    static double total(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
+        return -fused_loss_pass<BCEKernel, false>(PRED.data(), TRUE.data(), nullptr, PRED.size(), BCEKernel{0.f, 1e-7f});
+    }
+
+    template <int _RANK>
+    static int64_t normaliser(const Tensor<_RANK> &PRED) { return PRED.size(); }
+};
+
+struct BCEWithLogitsTerms {
+    template <int _RANK>
+    static double total(const Tensor<_RANK> &LOGITS, const Tensor<_RANK> &TRUE) {
+        return bce_with_logits_pass<false>(LOGITS, TRUE, nullptr, nullptr);
+    }
+
+    template <int _RANK>
+    static int64_t normaliser(const Tensor<_RANK> &LOGITS) { return LOGITS.size(); }
+};
+
+// Normalised per sample: the first dimension is the batch
+struct CCETerms {
+    template <int _RANK>
+    static double total(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
+        return -fused_loss_pass<CCEKernel, false>(PRED.data(), TRUE.data(), nullptr, PRED.size(), CCEKernel{0.f, 1e-15f});
+    }
+
+    template <int _RANK>
+    static int64_t normaliser(const Tensor<_RANK> &PRED) { return _RANK > 1 ? PRED.dimension(0) : 1; }
+};
+
+using MSEAccumulator = LossAccumulator<MSETerms>;
+using BCEAccumulator = LossAccumulator<BCETerms>;
+using BCEWithLogitsAccumulator = LossAccumulator<BCEWithLogitsTerms>;
+using CCEAccumulator = LossAccumulator<CCETerms>;
+
+// Classification accuracy over (batch, classes) tensors. With one class the
+// prediction is a probability thresholded at 0.5; otherwise the argmax of each
+// row is compared with the argmax of the one-hot label.
+class AccuracyAccumulator {
+public:
+    void update(const Tensor_2D &PRED, const Tensor_2D &TRUE) {
+        if (PRED.dimensions() != TRUE.dimensions()) throw std::invalid_argument("Prediction/label shape mismatch");
+        const Eigen::Index batch = PRED.dimension(0);
+        const Eigen::Index classes = PRED.dimension(1);
+
+        if (classes == 1) {
+            for (Eigen::Index i = 0; i < batch; ++i) {
+                correct += (PRED(i, 0) >= 0.5f) == (TRUE(i, 0) >= 0.5f);
+            }
+        } else {
+            // Column-major: walk the classes column by column, keeping a running argmax per row
+            std::vector<Eigen::Index> pred_arg(batch, 0), true_arg(batch, 0);
+            for (Eigen::Index c = 1; c < classes; ++c) {
+                for (Eigen::Index i = 0; i < batch; ++i) {
+                    if (PRED(i, c) > PRED(i, pred_arg[i])) pred_arg[i] = c;
+                    if (TRUE(i, c) > TRUE(i, true_arg[i])) true_arg[i] = c;
+                }
+            }
+            for (Eigen::Index i = 0; i < batch; ++i) correct += pred_arg[i] == true_arg[i];
+        }
+        seen += batch;
+    }
+
+    void merge(const AccuracyAccumulator &other) {
+        correct += other.correct;
+        seen += other.seen;
+    }
+
+    void reset() { *this = AccuracyAccumulator(); }
+
+    int64_t count() const { return seen; }
+
+    TYPE result() const { return seen == 0 ? 0.f : static_cast<TYPE>(static_cast<double>(correct) / static_cast<double>(seen)); }
+
+private:
+    int64_t correct = 0;
+    int64_t seen = 0;
+};
+
+#endif
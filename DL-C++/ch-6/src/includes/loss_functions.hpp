@@ -0,0 +1,401 @@
+#ifndef __MY_LOSS_FUNCTIONS__
+#define __MY_LOSS_FUNCTIONS__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "reduction.hpp"
+
+using TYPE = float;
+
+using Tensor_0D = Eigen::Tensor<TYPE, 0>;
+using Tensor_1D = Eigen::Tensor<TYPE, 1>;
+using Tensor_2D = Eigen::Tensor<TYPE, 2>;
+using Tensor_3D = Eigen::Tensor<TYPE, 3>;
+using Tensor_4D = Eigen::Tensor<TYPE, 4>;
+
+template<int _RANK>
+using Tensor = Eigen::Tensor<TYPE, _RANK>;
+
+template<int _RANK>
+using DimArray = Eigen::array<Eigen::DenseIndex, _RANK>;
+
+// Eigen's SIMD packet types carry vector attributes that GCC flags whenever
+// they are used as template arguments; Eigen silences the same warning internally.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+using Packet = Eigen::internal::packet_traits<TYPE>::type;
+constexpr Eigen::Index PacketSize = Eigen::internal::packet_traits<TYPE>::size;
+
+/*
+    Fused loss kernels.
+
+    Every kernel below is written once against Eigen's packet primitives
+    (padd, pmul, plog, ...). Those primitives also accept a plain TYPE, so the
+    same code runs on whole SIMD packets for the bulk of the tensor and on
+    single scalars for the tail.
+
+    A kernel returns the (unnormalised) loss term of its lanes and writes the
+    matching gradient lanes, so the loss and dL/dPRED share every load and
+    every transcendental call. The terms are reduced with blocked_reduce()
+    from reduction.hpp.
+*/
+template <typename Kernel, bool STORE_GRAD = true>
+double fused_loss_pass(const TYPE *pred, const TYPE *target, TYPE *grad, Eigen::Index size, const Kernel &kernel) {
+    using namespace Eigen::internal;
+
+    // Blocks write disjoint gradient ranges and return compensated partials,
+    // so the loss is bit-identical whatever the thread count.
+    return blocked_reduce(size, [&](Eigen::Index begin, Eigen::Index end) {
+        KahanAccumulator<TYPE> acc;
+        Eigen::Index i = begin;
+        for (; i + PacketSize <= end; i += PacketSize) {
+            Packet g;
+            acc.add_packet(kernel(ploadu<Packet>(pred + i), ploadu<Packet>(target + i), g));
+            if constexpr (STORE_GRAD) pstoreu(grad + i, g);
+        }
+        for (; i < end; ++i) {
+            TYPE g;
+            acc.add(kernel(pred[i], target[i], g));
+            if constexpr (STORE_GRAD) grad[i] = g;
+        }
+        return acc.value();
+    });
+}
+
+template <int _RANK>
+void check_loss_shapes(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE, const Tensor<_RANK> &GRAD) {
+    if (PRED.dimensions() != TRUE.dimensions()) throw std::invalid_argument("Prediction/label shape mismatch");
+    if (PRED.dimensions() != GRAD.dimensions()) throw std::invalid_argument("Gradient buffer shape mismatch");
+}
+
+/*
+    Per-sample variant of fused_loss_pass().
+
+    The batch is the first dimension, which is the fastest one in Eigen's
+    column-major layout, so a (rows, ...) tensor is a run of columns holding
+    `rows` contiguous samples each. Threads split the rows and walk every
+    column for their own rows, accumulating each sample's loss terms straight
+    into sample_loss, so no two threads touch the same sample. Optional
+    per-sample weights scale both the sample's share of the total and its
+    gradient, inside the same pass.
+
+    kernel_at(c) returns the kernel for column c (columns may carry their own
+    constants, e.g. pos_weight). sample_scale turns the accumulated terms into
+    the per-sample loss, chosen so that the unweighted loss is the mean of the
+    per-sample losses. Returns sum(weight * sample_loss).
+*/
+constexpr Eigen::Index SAMPLE_BLOCK_SIZE = 1024;
+
+template <typename KernelAt>
+double fused_loss_pass_per_sample(const TYPE *pred, const TYPE *target, TYPE *grad, Eigen::Index rows, Eigen::Index cols,
+                                  const KernelAt &kernel_at, TYPE sample_scale, const TYPE *weights, TYPE *sample_loss) {
+    using namespace Eigen::internal;
+
+    const Eigen::Index blocks = (rows + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE;
+    parallel_for(blocks, [&](Eigen::Index first, Eigen::Index last) {
+        const Eigen::Index row_begin = first * SAMPLE_BLOCK_SIZE;
+        const Eigen::Index row_end = std::min(rows, last * SAMPLE_BLOCK_SIZE);
+        std::fill(sample_loss + row_begin, sample_loss + row_end, 0.f);
+
+        for (Eigen::Index c = 0; c < cols; ++c) {
+            const auto kernel = kernel_at(c);
+            const Eigen::Index base = c * rows;
+            Eigen::Index r = row_begin;
+            for (; r + PacketSize <= row_end; r += PacketSize) {
+                Packet g;
+                Packet term = kernel(ploadu<Packet>(pred + base + r), ploadu<Packet>(target + base + r), g);
+                if (weights != nullptr) g = pmul(g, ploadu<Packet>(weights + r));
+                pstoreu(grad + base + r, g);
+                pstoreu(sample_loss + r, padd(ploadu<Packet>(sample_loss + r), term));
+            }
+            for (; r < row_end; ++r) {
+                TYPE g;
+                sample_loss[r] += kernel(pred[base + r], target[base + r], g);
+                grad[base + r] = weights != nullptr ? g * weights[r] : g;
+            }
+        }
+
+        for (Eigen::Index r = row_begin; r < row_end; ++r) sample_loss[r] *= sample_scale;
+    });
+
+    return blocked_reduce(rows, [&](Eigen::Index begin, Eigen::Index end) {
+        KahanAccumulator<TYPE> acc;
+        for (Eigen::Index r = begin; r < end; ++r) {
+            acc.add(weights != nullptr ? weights[r] * sample_loss[r] : sample_loss[r]);
+        }
+        return acc.value();
+    });
+}
+
+// Validates the optional per-sample buffers and runs fused_loss_pass_per_sample(),
+// using scratch space when only weights were asked for. Returns the mean over rows.
+template <int _RANK, typename KernelAt>
+TYPE per_sample_loss(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE, Tensor<_RANK> &GRAD, Eigen::Index rows,
+                     const KernelAt &kernel_at, TYPE sample_scale, const Tensor_1D *SAMPLE_WEIGHT, Tensor_1D *SAMPLE_LOSS) {
+    if (SAMPLE_WEIGHT != nullptr && SAMPLE_WEIGHT->dimension(0) != rows) throw std::invalid_argument("Sample weight size mismatch");
+    if (SAMPLE_LOSS != nullptr && SAMPLE_LOSS->dimension(0) != rows) throw std::invalid_argument("Sample loss buffer size mismatch");
+    if (rows == 0) return 0.f;
+
+    std::vector<TYPE> scratch;
+    TYPE *sample_loss = SAMPLE_LOSS != nullptr ? SAMPLE_LOSS->data() : (scratch.resize(rows), scratch.data());
+    const TYPE *weights = SAMPLE_WEIGHT != nullptr ? SAMPLE_WEIGHT->data() : nullptr;
+
+    double total = fused_loss_pass_per_sample(PRED.data(), TRUE.data(), GRAD.data(), rows, PRED.size() / rows,
+                                              kernel_at, sample_scale, weights, sample_loss);
+    return static_cast<TYPE>(total / rows);
+}
+
+// Indices of the k largest per-sample losses, hardest first. nth_element
+// partitions in O(n), so only the k selected samples are sorted.
+inline std::vector<Eigen::Index> top_k_hardest(const Tensor_1D &SAMPLE_LOSS, Eigen::Index k) {
+    const Eigen::Index n = SAMPLE_LOSS.dimension(0);
+    k = std::clamp<Eigen::Index>(k, 0, n);
+
+    std::vector<Eigen::Index> indices(n);
+    for (Eigen::Index i = 0; i < n; ++i) indices[i] = i;
+
+    // Ties broken by index so the selection is deterministic
+    auto harder = [&SAMPLE_LOSS](Eigen::Index a, Eigen::Index b) {
+        return SAMPLE_LOSS(a) > SAMPLE_LOSS(b) || (SAMPLE_LOSS(a) == SAMPLE_LOSS(b) && a < b);
+    };
+    if (k < n) std::nth_element(indices.begin(), indices.begin() + k, indices.end(), harder);
+    std::sort(indices.begin(), indices.begin() + k, harder);
+    indices.resize(k);
+    return indices;
+}
+
+// d = PRED - TRUE, loss term d^2, gradient 2d/N
+struct MSEKernel {
+    TYPE grad_scale;
+
+    template <typename P>
+    P operator()(const P &pred, const P &target, P &grad) const {
+        using namespace Eigen::internal;
+        P diff = psub(pred, target);
+        grad = pmul(diff, pset1<P>(grad_scale));
+        return pmul(diff, diff);
+    }
+};
+
+// loss term t*log(p+eps) + (1-t)*log(1-p+eps), gradient -(t/(p+eps) - (1-t)/(1-p+eps))/N
+struct BCEKernel {
+    TYPE grad_scale;
+    TYPE epsilon;
+
+    template <typename P>
+    P operator()(const P &pred, const P &target, P &grad) const {
+        using namespace Eigen::internal;
+        const P one = pset1<P>(1.f);
+        const P eps = pset1<P>(epsilon);
+        P p = padd(pred, eps);
+        P q = padd(psub(one, pred), eps);
+        P comp_target = psub(one, target);
+        grad = pmul(psub(pdiv(comp_target, q), pdiv(target, p)), pset1<P>(grad_scale));
+        return padd(pmul(target, plog(p)), pmul(comp_target, plog(q)));
+    }
+};
+
+// loss term t*log(clip(p)), gradient -t/clip(p)/batch
+struct CCEKernel {
+    TYPE grad_scale;
+    TYPE epsilon;
+
+    template <typename P>
+    P operator()(const P &pred, const P &target, P &grad) const {
+        using namespace Eigen::internal;
+        P clipped = pmin(pmax(pred, pset1<P>(epsilon)), pset1<P>(1.f - epsilon));
+        grad = pmul(pdiv(target, clipped), pset1<P>(-grad_scale));
+        return pmul(target, plog(clipped));
+    }
+};
+
+/*
+    BCE on logits: with e = exp(-|x|) and c = 1 + (pos_weight - 1) * y,
+
+        loss = (1 - y) * x + c * (max(-x, 0) + log1p(e))
+        dL/dx = (1 - y) - c * (1 - sigmoid(x))
+
+    which is max(x, 0) - x*y + log1p(exp(-|x|)) when pos_weight == 1. The one
+    exp feeds both log1p and sigmoid (1/(1+e) or e/(1+e) depending on the sign
+    of x), so nothing overflows and no probability is ever materialised.
+*/
+struct BCEWithLogitsKernel {
+    TYPE grad_scale;
+    TYPE pos_weight;
+
+    template <typename P>
+    P operator()(const P &logit, const P &target, P &grad) const {
+        using namespace Eigen::internal;
+        const P zero = pset1<P>(0.f);
+        const P one = pset1<P>(1.f);
+        P e = pexp(pnegate(pabs(logit)));
+        P u = padd(one, e);
+
+        // log1p(e) = log(u) * e / (u - 1), falling back to e once u rounds to 1
+        P log1p_e = pselect(pcmp_eq(u, one), e, pmul(plog(u), pdiv(e, psub(u, one))));
+        P softplus_neg = padd(pmax(pnegate(logit), zero), log1p_e);
+
+        P comp_target = psub(one, target);
+        P c = padd(one, pmul(pset1<P>(pos_weight - 1.f), target));
+        P sigmoid = pdiv(pselect(pcmp_le(zero, logit), one, e), u);
+
+        grad = pmul(psub(comp_target, pmul(c, psub(one, sigmoid))), pset1<P>(grad_scale));
+        return padd(pmul(comp_target, logit), pmul(c, softplus_neg));
+    }
+};
+
+// Runs the logits kernel once per class. The class axis is the last one, which
+// in Eigen's column-major layout is the slowest, so each class is a contiguous
+// segment sharing a single pos_weight.
+template <bool STORE_GRAD, int _RANK>
+double bce_with_logits_pass(const Tensor<_RANK> &LOGITS, const Tensor<_RANK> &TRUE, TYPE *grad, const Tensor_1D *POS_WEIGHT) {
+    const Eigen::Index size = LOGITS.size();
+    const TYPE grad_scale = 1.f / static_cast<TYPE>(size);
+    if (POS_WEIGHT == nullptr) {
+        return fused_loss_pass<BCEWithLogitsKernel, STORE_GRAD>(LOGITS.data(), TRUE.data(), grad, size, BCEWithLogitsKernel{grad_scale, 1.f});
+    }
+
+    const Eigen::Index classes = LOGITS.dimension(_RANK - 1);
+    if (POS_WEIGHT->dimension(0) != classes) throw std::invalid_argument("pos_weight size mismatch");
+    if (size == 0) return 0.;
+
+    const Eigen::Index segment = size / classes;
+    double sum = 0.;
+    for (Eigen::Index c = 0; c < classes; ++c) {
+        const Eigen::Index offset = c * segment;
+        sum += fused_loss_pass<BCEWithLogitsKernel, STORE_GRAD>(LOGITS.data() + offset, TRUE.data() + offset, STORE_GRAD ? grad + offset : nullptr, segment,
+                                                                BCEWithLogitsKernel{grad_scale, (*POS_WEIGHT)(c)});
+    }
+    return sum;
+}
+
+// Binary Cross-Entropy computed straight from logits (sigmoid folded in).
+// POS_WEIGHT, if given, holds one weight per class (last dimension) for the positive term.
+template <int _RANK>
+TYPE bce_with_logits(const Tensor<_RANK> &LOGITS, const Tensor<_RANK> &TRUE, const Tensor_1D *POS_WEIGHT = nullptr) {
+    if (LOGITS.dimensions() != TRUE.dimensions()) throw std::invalid_argument("Prediction/label shape mismatch");
+    return static_cast<TYPE>(bce_with_logits_pass<false>(LOGITS, TRUE, nullptr, POS_WEIGHT) / LOGITS.size());
+}
+
+// Per-sample bce_with_logits() of a rank-1 tensor with pos_weight: every row
+// is one sample and its own class, so the kernel changes from element to element.
+inline TYPE bce_with_logits_rows(const Tensor_1D &LOGITS, const Tensor_1D &TRUE, Tensor_1D &GRAD, const Tensor_1D &POS_WEIGHT,
+                                 const Tensor_1D *SAMPLE_WEIGHT, Tensor_1D *SAMPLE_LOSS) {
+    const Eigen::Index rows = LOGITS.dimension(0);
+    if (SAMPLE_WEIGHT != nullptr && SAMPLE_WEIGHT->dimension(0) != rows) throw std::invalid_argument("Sample weight size mismatch");
+    if (SAMPLE_LOSS != nullptr && SAMPLE_LOSS->dimension(0) != rows) throw std::invalid_argument("Sample loss buffer size mismatch");
+    if (rows == 0) return 0.f;
+
+    const TYPE grad_scale = 1.f / static_cast<TYPE>(rows);
+    double total = blocked_reduce(rows, [&](Eigen::Index begin, Eigen::Index end) {
+        KahanAccumulator<TYPE> acc;
+        for (Eigen::Index r = begin; r < end; ++r) {
+            TYPE g;
+            const TYPE loss = BCEWithLogitsKernel{grad_scale, POS_WEIGHT(r)}(LOGITS(r), TRUE(r), g);
+            const TYPE weight = SAMPLE_WEIGHT != nullptr ? (*SAMPLE_WEIGHT)(r) : 1.f;
+            GRAD(r) = g * weight;
+            if (SAMPLE_LOSS != nullptr) (*SAMPLE_LOSS)(r) = loss;
+            acc.add(weight * loss);
+        }
+        return acc.value();
+    });
+    return static_cast<TYPE>(total / rows);
+}
+
+// bce_with_logits() and its gradient w.r.t. LOGITS, written into GRAD.
+// SAMPLE_WEIGHT / SAMPLE_LOSS, if given, are per-row (first dimension) weights
+// and a buffer receiving each row's loss.
+template <int _RANK>
+TYPE bce_with_logits_value_and_grad(const Tensor<_RANK> &LOGITS, const Tensor<_RANK> &TRUE, Tensor<_RANK> &GRAD, const Tensor_1D *POS_WEIGHT = nullptr,
+                                    const Tensor_1D *SAMPLE_WEIGHT = nullptr, Tensor_1D *SAMPLE_LOSS = nullptr) {
+    check_loss_shapes(LOGITS, TRUE, GRAD);
+    if (SAMPLE_WEIGHT == nullptr && SAMPLE_LOSS == nullptr) {
+        return static_cast<TYPE>(bce_with_logits_pass<true>(LOGITS, TRUE, GRAD.data(), POS_WEIGHT) / LOGITS.size());
+    }
+
+    const Eigen::Index rows = LOGITS.dimension(0);
+    const Eigen::Index cols = rows > 0 ? LOGITS.size() / rows : 0;
+    const Eigen::Index classes = LOGITS.dimension(_RANK - 1);
+    if (POS_WEIGHT != nullptr && POS_WEIGHT->dimension(0) != classes) throw std::invalid_argument("pos_weight size mismatch");
+    if constexpr (_RANK == 1) {
+        if (POS_WEIGHT != nullptr) return bce_with_logits_rows(LOGITS, TRUE, GRAD, *POS_WEIGHT, SAMPLE_WEIGHT, SAMPLE_LOSS);
+    }
+
+    // Columns of the same class are adjacent because the class axis is the slowest
+    const Eigen::Index cols_per_class = std::max<Eigen::Index>(1, classes > 0 ? cols / classes : 1);
+    const TYPE grad_scale = 1.f / static_cast<TYPE>(LOGITS.size());
+    auto kernel_at = [&](Eigen::Index c) {
+        return BCEWithLogitsKernel{grad_scale, POS_WEIGHT != nullptr ? (*POS_WEIGHT)(c / cols_per_class) : 1.f};
+    };
+    return per_sample_loss(LOGITS, TRUE, GRAD, rows, kernel_at, 1.f / static_cast<TYPE>(cols), SAMPLE_WEIGHT, SAMPLE_LOSS);
+}
+
+/*
+    The *_value_and_grad() entry points below share the optional per-sample
+    arguments: SAMPLE_WEIGHT holds one weight per row (first dimension) and
+    SAMPLE_LOSS receives one loss per row. Without them the flat kernel runs;
+    with them the per-sample kernel runs, still in a single pass.
+*/
+
+// Mean Squared Error and its gradient w.r.t. PRED, written into GRAD.
+template <int _RANK>
+TYPE mse_value_and_grad(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE, Tensor<_RANK> &GRAD,
+                        const Tensor_1D *SAMPLE_WEIGHT = nullptr, Tensor_1D *SAMPLE_LOSS = nullptr) {
+    check_loss_shapes(PRED, TRUE, GRAD);
+    const TYPE n = static_cast<TYPE>(PRED.size());
+    const MSEKernel kernel{2.f / n};
+    if (SAMPLE_WEIGHT == nullptr && SAMPLE_LOSS == nullptr) {
+        double sum = fused_loss_pass(PRED.data(), TRUE.data(), GRAD.data(), PRED.size(), kernel);
+        return static_cast<TYPE>(sum / n);
+    }
+
+    const Eigen::Index rows = PRED.dimension(0);
+    const TYPE cols = rows > 0 ? n / static_cast<TYPE>(rows) : 1.f;
+    return per_sample_loss(PRED, TRUE, GRAD, rows, [&kernel](Eigen::Index) { return kernel; }, 1.f / cols, SAMPLE_WEIGHT, SAMPLE_LOSS);
+}
+
+// Binary Cross-Entropy (on probabilities) and its gradient w.r.t. PRED, written into GRAD.
+template <int _RANK>
+TYPE bce_value_and_grad(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE, Tensor<_RANK> &GRAD,
+                        const Tensor_1D *SAMPLE_WEIGHT = nullptr, Tensor_1D *SAMPLE_LOSS = nullptr) {
+    check_loss_shapes(PRED, TRUE, GRAD);
+    const TYPE n = static_cast<TYPE>(PRED.size());
+    const BCEKernel kernel{1.f / n, 1e-7f};
+    if (SAMPLE_WEIGHT == nullptr && SAMPLE_LOSS == nullptr) {
+        double sum = fused_loss_pass(PRED.data(), TRUE.data(), GRAD.data(), PRED.size(), kernel);
+        return static_cast<TYPE>(-sum / n);
+    }
+
+    const Eigen::Index rows = PRED.dimension(0);
+    const TYPE cols = rows > 0 ? n / static_cast<TYPE>(rows) : 1.f;
+    return per_sample_loss(PRED, TRUE, GRAD, rows, [&kernel](Eigen::Index) { return kernel; }, -1.f / cols, SAMPLE_WEIGHT, SAMPLE_LOSS);
+}
+
+// Categorical Cross-Entropy and its gradient w.r.t. PRED, written into GRAD.
+// As in categorical_cross_entropy(), the first dimension is the batch.
+template <int _RANK>
+TYPE categorical_cross_entropy_value_and_grad(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE, Tensor<_RANK> &GRAD,
+                                              const Tensor_1D *SAMPLE_WEIGHT = nullptr, Tensor_1D *SAMPLE_LOSS = nullptr) {
+    check_loss_shapes(PRED, TRUE, GRAD);
+    const Eigen::Index rows = _RANK > 1 ? PRED.dimension(0) : 1;
+    const TYPE batch_size = static_cast<TYPE>(rows);
+    const CCEKernel kernel{1.f / batch_size, 1e-15f};
+    if (SAMPLE_WEIGHT == nullptr && SAMPLE_LOSS == nullptr) {
+        double sum = fused_loss_pass(PRED.data(), TRUE.data(), GRAD.data(), PRED.size(), kernel);
+        return static_cast<TYPE>(-sum / batch_size);
+    }
+
+    return per_sample_loss(PRED, TRUE, GRAD, rows, [&kernel](Eigen::Index) { return kernel; }, -1.f, SAMPLE_WEIGHT, SAMPLE_LOSS);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
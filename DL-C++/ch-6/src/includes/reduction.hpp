@@ -0,0 +1,133 @@
+#ifndef __MY_REDUCTION__
+#define __MY_REDUCTION__
+
+#include <algorithm>
+#include <vector>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "parallel.hpp"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+/*
+    Deterministic reductions.
+
+    The input is cut into fixed REDUCTION_BLOCK_SIZE blocks. Each block is
+    summed on its own with Kahan compensation (one compensated accumulator per
+    SIMD lane), and the block partials are then combined pairwise, in double,
+    in index order. Block boundaries and the combine order never depend on how
+    many threads ran the blocks, so the result is bit-identical for any thread
+    count on a given build.
+*/
+
+constexpr Eigen::Index REDUCTION_BLOCK_SIZE = 1 << 14;
+constexpr Eigen::Index MIN_BLOCKS_PER_THREAD = 4;
+
+template <typename Scalar>
+class KahanAccumulator {
+public:
+    using Packet = typename Eigen::internal::packet_traits<Scalar>::type;
+    static constexpr int PacketSize = Eigen::internal::packet_traits<Scalar>::size;
+
+    void add_packet(const Packet &x) {
+        using namespace Eigen::internal;
+        Packet y = psub(x, packet_comp);
+        Packet t = padd(packet_sum, y);
+        packet_comp = psub(psub(t, packet_sum), y);
+        packet_sum = t;
+    }
+
+    void add(Scalar x) {
+        Scalar y = x - scalar_comp;
+        Scalar t = scalar_sum + y;
+        scalar_comp = (t - scalar_sum) - y;
+        scalar_sum = t;
+    }
+
+    double value() const {
+        Scalar sums[PacketSize], comps[PacketSize];
+        Eigen::internal::pstoreu(sums, packet_sum);
+        Eigen::internal::pstoreu(comps, packet_comp);
+
+        double total = static_cast<double>(scalar_sum) - static_cast<double>(scalar_comp);
+        for (int lane = 0; lane < PacketSize; ++lane) {
+            total += static_cast<double>(sums[lane]) - static_cast<double>(comps[lane]);
+        }
+        return total;
+    }
+
+private:
+    Packet packet_sum = Eigen::internal::pset1<Packet>(Scalar(0));
+    Packet packet_comp = Eigen::internal::pset1<Packet>(Scalar(0));
+    Scalar scalar_sum = 0;
+    Scalar scalar_comp = 0;
+};
+
+// Pairwise (cascade) summation: the rounding error grows with log(n) instead of n.
+inline double pairwise_sum(const double *values, Eigen::Index size) {
+    if (size <= 8) {
+        double sum = 0.;
+        for (Eigen::Index i = 0; i < size; ++i) sum += values[i];
+        return sum;
+    }
+    const Eigen::Index half = size / 2;
+    return pairwise_sum(values, half) + pairwise_sum(values + half, size - half);
+}
+
+// Calls block_fn(begin, end) once per fixed-size block, in parallel, and
+// combines the returned partials pairwise in block order.
+template <typename BlockFn>
+double blocked_reduce(Eigen::Index size, BlockFn &&block_fn, int num_threads = get_num_threads()) {
+    if (size <= 0) return 0.;
+
+    const Eigen::Index blocks = (size + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+    const Eigen::Index threads = std::clamp<Eigen::Index>(blocks / MIN_BLOCKS_PER_THREAD, 1, std::max(1, num_threads));
+
+    std::vector<double> partials(blocks);
+    parallel_for(blocks, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index b = first; b < last; ++b) {
+            const Eigen::Index begin = b * REDUCTION_BLOCK_SIZE;
+            partials[b] = block_fn(begin, std::min(size, begin + REDUCTION_BLOCK_SIZE));
+        }
+    }, static_cast<int>(threads));
+
+    return pairwise_sum(partials.data(), blocks);
+}
+
+template <typename Scalar>
+double deterministic_sum(const Scalar *data, Eigen::Index size, int num_threads = get_num_threads()) {
+    using Accumulator = KahanAccumulator<Scalar>;
+    constexpr Eigen::Index Step = Accumulator::PacketSize;
+    return blocked_reduce(size, [data](Eigen::Index begin, Eigen::Index end) {
+        using Eigen::internal::ploadu;
+        using Packet = typename Accumulator::Packet;
+
+        // Four independent accumulators hide the latency of the Kahan update chain
+        Accumulator acc[4];
+        Eigen::Index i = begin;
+        for (; i + 4 * Step <= end; i += 4 * Step) {
+            acc[0].add_packet(ploadu<Packet>(data + i));
+            acc[1].add_packet(ploadu<Packet>(data + i + Step));
+            acc[2].add_packet(ploadu<Packet>(data + i + 2 * Step));
+            acc[3].add_packet(ploadu<Packet>(data + i + 3 * Step));
+        }
+        for (; i + Step <= end; i += Step) acc[0].add_packet(ploadu<Packet>(data + i));
+        for (; i < end; ++i) acc[0].add(data[i]);
+        return (acc[0].value() + acc[1].value()) + (acc[2].value() + acc[3].value());
+    }, num_threads);
+}
+
+// Drop-in replacement for ((Tensor_0D)(x.sum()))(0) on an evaluated tensor
+template <typename Scalar, int _RANK>
+Scalar deterministic_sum(const Eigen::Tensor<Scalar, _RANK> &x, int num_threads = get_num_threads()) {
+    return static_cast<Scalar>(deterministic_sum(x.data(), x.size(), num_threads));
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -5,24 +5,13 @@
 #include <random>       // Add this line
 #include <unsupported/Eigen/CXX11/Tensor>
 
-using TYPE = float;
+#include "includes/loss_accumulators.hpp"
 
-using Tensor_0D = Eigen::Tensor<TYPE, 0>;
-using Tensor_1D = Eigen::Tensor<TYPE, 1>;
-using Tensor_2D = Eigen::Tensor<TYPE, 2>;
-using Tensor_3D = Eigen::Tensor<TYPE, 3>;
-using Tensor_4D = Eigen::Tensor<TYPE, 4>;
-
-template<int _RANK>
-using Tensor = Eigen::Tensor<TYPE, _RANK>;
-
-template<int _RANK>
-using DimArray = Eigen::array<Eigen::DenseIndex, _RANK>;
 template <int _RANK>
 auto mse(const Tensor<_RANK> &PRED, const Tensor<_RANK> &TRUE) {
     auto diff = TRUE - PRED;
-    auto loss = diff.pow(2.);
-    TYPE sum = ((Tensor_0D)(loss.sum()))(0);
+    Tensor<_RANK> loss = diff.pow(2.);
+    TYPE sum = deterministic_sum(loss);
     TYPE result = sum / PRED.size();
     return result;
 }
@@ -64,5 +53,45 @@ int main(int, char**)
     std::cout << "Cost(Y, H0): " << cost_h0 << std::endl;
     std::cout << "Cost(Y, H1): " << cost_h1 << std::endl;
 
+    // Same costs through the fused kernel, which also hands back dCost/dH
+    Tensor_2D grad_h1(H1.dimensions());
+    float fused_h1 = mse_value_and_grad(H1, Y, grad_h1);
+
+    std::cout << "Fused Cost(Y, H1): " << fused_h1 << std::endl;
+    std::cout << "dCost/dH1(0, 0): " << grad_h1(0, 0) << std::endl;
+
+    // Streaming evaluation: H1/Y arrive in mini-batches of 8 instances and are
+    // split over two accumulators, as two worker threads would, then merged.
+    // Only the running totals are kept, whatever the dataset size.
+    MSEAccumulator first_worker, second_worker;
+    const int total_size = static_cast<int>(Y.dimension(1));
+    const int mini_batch = 8;
+    for (int offset = 0; offset < total_size; offset += mini_batch) {
+        DimArray<2> start{0, offset};
+        DimArray<2> extent{1, std::min(mini_batch, total_size - offset)};
+        Tensor_2D pred_batch = H1.slice(start, extent);
+        Tensor_2D true_batch = Y.slice(start, extent);
+        (offset < total_size / 2 ? first_worker : second_worker).update(pred_batch, true_batch);
+    }
+    first_worker.merge(second_worker);
+
+    std::cout << "Streamed Cost(Y, H1): " << first_worker.result()
+              << " over " << first_worker.count() << " values" << std::endl;
+
+    // Reducing 16M copies of 0.1f: a plain float sum drifts, the blocked
+    // compensated sum does not, and it gives the same bits on 1 or N threads
+    Tensor_1D big(1 << 24);
+    big.setConstant(0.1f);
+
+    float naive_sum = ((Tensor_0D)(big.sum()))(0);
+    float single_thread_sum = deterministic_sum(big, 1);
+    float multi_thread_sum = deterministic_sum(big, 4);
+
+    std::cout << std::setprecision(2) << std::fixed;
+    std::cout << "Expected sum:              " << (1 << 24) * 0.1 << std::endl;
+    std::cout << "Tensor::sum():             " << naive_sum << std::endl;
+    std::cout << "deterministic_sum (1 thr): " << single_thread_sum << std::endl;
+    std::cout << "deterministic_sum (4 thr): " << multi_thread_sum << std::endl;
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "includes/pooling.hpp"
+
+/*
+    Batched max_pool2d(), avg_pool2d() and global_avg_pool2d() against
+    plain loops for every padding mode, in NCHW and NHWC, then timed on a
+    32 x 64 x 112 x 112 activation against pooling each channel plane with
+    its own 2-D pooling() call.
+*/
+
+using Tensor4D = PoolTensor<float>;
+
+const Eigen::array<int, 4> TO_NHWC{{0, 2, 3, 1}};
+const Eigen::array<int, 4> TO_NCHW{{0, 3, 1, 2}};
+
+Tensor4D reference_pool(const Tensor4D &x, const Pool2DOptions &o, bool average) {
+    const PoolAxis ah = pool_axis(x.dimension(2), o.size_h, o.stride_h, o.padding, o.pad_h);
+    const PoolAxis aw = pool_axis(x.dimension(3), o.size_w, o.stride_w, o.padding, o.pad_w);
+    Tensor4D out(x.dimension(0), x.dimension(1), ah.out, aw.out);
+    for (Eigen::Index n = 0; n < x.dimension(0); ++n)
+    for (Eigen::Index c = 0; c < x.dimension(1); ++c)
+    for (Eigen::Index oh = 0; oh < ah.out; ++oh)
+    for (Eigen::Index ow = 0; ow < aw.out; ++ow) {
+        float best = -std::numeric_limits<float>::infinity(), sum = 0;
+        Eigen::Index count = 0;
+        for (Eigen::Index i = 0; i < o.size_h; ++i)
+        for (Eigen::Index j = 0; j < o.size_w; ++j) {
+            const Eigen::Index h = oh * o.stride_h - ah.pad + i, w = ow * o.stride_w - aw.pad + j;
+            if (h < 0 || h >= x.dimension(2) || w < 0 || w >= x.dimension(3)) continue;
+            best = std::max(best, x(n, c, h, w));
+            sum += x(n, c, h, w);
+            ++count;
+        }
+        const float divisor = o.count_include_pad ? float(o.size_h * o.size_w) : float(count);
+        out(n, c, oh, ow) = average ? sum / divisor : best;
+    }
+    return out;
+}
+
+float max_diff(const Tensor4D &a, const Tensor4D &b) {
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (a - b).abs().maximum();
+    return diff();
+}
+
+void check(const char *name, Pool2DOptions o) {
+    Tensor4D x(2, 5, 11, 9);
+    x.setRandom();
+    const Tensor4D x_nhwc = x.shuffle(TO_NHWC);
+
+    o.layout = PoolLayout::NCHW;
+    MaxPoolIndices nchw_indices;
+    const Tensor4D max_nchw = max_pool2d(x, o, &nchw_indices);
+    const Tensor4D avg_nchw = avg_pool2d(x, o);
+    Tensor4D grad_output(max_nchw.dimensions());
+    grad_output.setRandom();
+    const Tensor4D grad_nchw = max_pool2d_backward(grad_output, nchw_indices);
+
+    o.layout = PoolLayout::NHWC;
+    MaxPoolIndices nhwc_indices;
+    const Tensor4D max_nhwc = max_pool2d(x_nhwc, o, &nhwc_indices).shuffle(TO_NCHW);
+    const Tensor4D avg_nhwc = avg_pool2d(x_nhwc, o).shuffle(TO_NCHW);
+    const Tensor4D grad_nhwc = max_pool2d_backward(Tensor4D(grad_output.shuffle(TO_NHWC)), nhwc_indices).shuffle(TO_NCHW);
+
+    const Tensor4D max_ref = reference_pool(x, o, false), avg_ref = reference_pool(x, o, true);
+    std::cout << std::left << std::setw(32) << name << std::right << "output " << max_ref.dimension(2) << "x"
+              << max_ref.dimension(3) << "  max |diff| NCHW max " << max_diff(max_nchw, max_ref) << ", avg "
+              << max_diff(avg_nchw, avg_ref) << "  NHWC max " << max_diff(max_nhwc, max_ref) << ", avg "
+              << max_diff(avg_nhwc, avg_ref) << "  backward NHWC vs NCHW " << max_diff(grad_nhwc, grad_nchw) << std::endl;
+}
+
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+int main() {
+    std::cout << "Batched pooling against plain loops" << std::endl;
+    check("2x2/2 valid", Pool2DOptions());
+    Pool2DOptions same;
+    same.size_h = same.size_w = 3;
+    same.padding = PoolPadding::Same;
+    check("3x3/2 same", same);
+    Pool2DOptions padded;
+    padded.size_h = padded.size_w = 3;
+    padded.stride_h = padded.stride_w = 1;
+    padded.padding = PoolPadding::Explicit;
+    padded.pad_h = padded.pad_w = 1;
+    check("3x3/1 pad 1", padded);
+    padded.count_include_pad = true;
+    check("3x3/1 pad 1, count_include_pad", padded);
+    Pool2DOptions odd;
+    odd.size_h = 4;
+    odd.size_w = 2;
+    odd.stride_h = 3;
+    odd.stride_w = 1;
+    odd.padding = PoolPadding::Same;
+    check("4x2/3x1 same", odd);
+
+    Tensor4D x(2, 5, 11, 9);
+    x.setRandom();
+    Eigen::Tensor<float, 2, Eigen::RowMajor> expected = x.mean(Eigen::array<int, 2>{{2, 3}});
+    const Tensor4D global_nchw = global_avg_pool2d(x);
+    const Tensor4D global_nhwc = global_avg_pool2d(Tensor4D(x.shuffle(TO_NHWC)), PoolLayout::NHWC);
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff_nchw = (global_nchw.reshape(expected.dimensions()) - expected).abs().maximum();
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff_nhwc = (global_nhwc.reshape(expected.dimensions()) - expected).abs().maximum();
+    std::cout << "global average                  max |diff| NCHW " << diff_nchw() << ", NHWC " << diff_nhwc() << std::endl;
+
+    // 32 x 64 x 112 x 112, 2x2/2 max-pool: a 2-D pooling() call per channel plane against one batched call
+    const Eigen::Index N = 32, C = 64, H = 112, W = 112;
+    Tensor4D activation(N, C, H, W);
+    activation.setRandom();
+    const Tensor4D activation_nhwc = activation.shuffle(TO_NHWC);
+    Pool2DOptions options;
+    Pool2DOptions options_nhwc;
+    options_nhwc.layout = PoolLayout::NHWC;
+
+    const double per_plane_ms = best_time_ms([&] {
+        Tensor4D out(N, C, H / 2, W / 2);
+        for (Eigen::Index p = 0; p < N * C; ++p) {
+            // A row-major H x W plane is the column-major W x H one, and max-pooling commutes with transposes
+            Eigen::TensorMap<const Eigen::Tensor<float, 2>> plane(activation.data() + p * H * W, W, H);
+            Eigen::Tensor<float, 2> pooled = pooling(Eigen::Tensor<float, 2>(plane), 2, 2);
+            std::copy(pooled.data(), pooled.data() + pooled.size(), out.data() + p * pooled.size());
+        }
+    });
+    std::cout << std::endl << "32x64x112x112, 2x2/2 max-pool" << std::endl;
+    std::cout << "pooling() per channel plane: " << per_plane_ms << " ms" << std::endl;
+    for (int threads : {1, get_num_threads()}) {
+        set_num_threads(threads);
+        const double nchw_ms = best_time_ms([&] { max_pool2d(activation, options); });
+        const double nhwc_ms = best_time_ms([&] { max_pool2d(activation_nhwc, options_nhwc); });
+        const double avg_ms = best_time_ms([&] { avg_pool2d(activation, options); });
+        const double global_ms = best_time_ms([&] { global_avg_pool2d(activation); });
+        std::cout << threads << " thread(s): max_pool2d NCHW " << nchw_ms << " ms, NHWC " << nhwc_ms << " ms, avg_pool2d "
+                  << avg_ms << " ms, global_avg_pool2d " << global_ms << " ms" << std::endl;
+    }
+    set_num_threads(0);
+    return 0;
+}
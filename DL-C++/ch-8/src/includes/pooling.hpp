@@ -0,0 +1,560 @@
+#ifndef __MY_POOLING__
+#define __MY_POOLING__
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Core>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "parallel.hpp"
+#include "summed_area.hpp"
+
+/*
+    Max-pooling of a 2-D Eigen tensor with square pool_size x pool_size
+    windows and "valid" padding:
+        out_rows = (rows - pool_size) / stride + 1
+        out_cols = (cols - pool_size) / stride + 1
+
+    The windows are reduced in place instead of being materialised as
+    extract_image_patches() patches (pool_size^2 x outputs values, 4x the
+    input for a 2x2/2 pool). Eigen tensors are column-major, so each input
+    column is contiguous. For every output column:
+        1. the pool_size input columns under the window are reduced into one
+           column with an element-wise max (a packet max over contiguous
+           memory);
+        2. that column is reduced over each window's pool_size rows, as
+           pool_size strided maxima into the output column (contiguous, and
+           so vectorised, when stride is 1).
+    Every input element is read ceil(pool_size / stride) times at most, and
+    the only scratch is that one column of `rows` values.
+*/
+
+template <typename T>
+Eigen::Tensor<T, 2> pooling(const Eigen::Tensor<T, 2> &x, int pool_size, int stride = 1) {
+    if (pool_size < 1 || stride < 1) throw std::invalid_argument("Pool size and stride must be positive");
+    const Eigen::Index rows = x.dimension(0);
+    const Eigen::Index cols = x.dimension(1);
+    if (rows < pool_size || cols < pool_size) throw std::invalid_argument("Pool window larger than input");
+
+    using Column = Eigen::Array<T, Eigen::Dynamic, 1>;
+    using StridedColumn = Eigen::Map<const Column, 0, Eigen::InnerStride<>>;
+
+    const Eigen::Index out_rows = (rows - pool_size) / stride + 1;
+    const Eigen::Index out_cols = (cols - pool_size) / stride + 1;
+    Eigen::Tensor<T, 2> result(out_rows, out_cols);
+
+    Column column_max(rows);
+    for (Eigen::Index oc = 0; oc < out_cols; ++oc) {
+        const T *first = x.data() + oc * stride * rows;
+        column_max = Eigen::Map<const Column>(first, rows);
+        for (int j = 1; j < pool_size; ++j) {
+            column_max = column_max.max(Eigen::Map<const Column>(first + j * rows, rows));
+        }
+
+        Eigen::Map<Column> out(result.data() + oc * out_rows, out_rows);
+        out = StridedColumn(column_max.data(), out_rows, Eigen::InnerStride<>(stride));
+        for (int i = 1; i < pool_size; ++i) {
+            out = out.max(StridedColumn(column_max.data() + i, out_rows, Eigen::InnerStride<>(stride)));
+        }
+    }
+    return result;
+}
+
+/*
+    Batched pooling over rank-4 row-major tensors in either NCHW or NHWC
+    order: max_pool2d() (optionally recording argmax indices for the
+    backward pass), avg_pool2d() (from summed-area tables for large
+    windows, see further down) and global_avg_pool2d().
+
+    Padding is Valid (windows inside the input), Same (ceil(in / stride)
+    outputs, the padding split with the odd element at the bottom/right) or
+    Explicit (pad_h / pad_w on each side, smaller than the window). Padded
+    positions never win a max; an average divides by the in-bounds count
+    unless count_include_pad is set.
+
+    NCHW: each (image, channel) plane is one task for parallel_for(). A
+    plane's rows are contiguous, so an output row is computed as for
+    pooling() above with the roles of rows and columns swapped: the input
+    rows under it are reduced into one row, then that row is reduced over
+    each window's columns. With indices the row reduction also records
+    which of the rows won, and the window's argmax h * W + w is assembled
+    from that and the winning column.
+
+    NHWC: each (image, output row) is one task, and every window position
+    combines C-vectors, contiguous in memory, with packet maxima and sums.
+
+    Ties go to the leftmost column, then to the topmost row, in both
+    layouts. The indices are int32, one per output element, so the backward
+    pass is an O(output) scatter of grad_output into a zeroed gradient: no
+    window is searched again.
+*/
+
+template <typename T>
+using PoolTensor = Eigen::Tensor<T, 4, Eigen::RowMajor>;
+
+enum class PoolPadding { Valid, Same, Explicit };
+enum class PoolLayout { NCHW, NHWC };
+enum class PoolMethod { Auto, Direct, Integral };
+
+struct Pool2DOptions {
+    Eigen::Index size_h = 2;
+    Eigen::Index size_w = 2;
+    Eigen::Index stride_h = 2;
+    Eigen::Index stride_w = 2;
+    PoolPadding padding = PoolPadding::Valid;
+    Eigen::Index pad_h = 0;            // Explicit padding only
+    Eigen::Index pad_w = 0;
+    bool count_include_pad = false;    // avg_pool2d(): divide by the full window
+    PoolLayout layout = PoolLayout::NCHW;
+    PoolMethod method = PoolMethod::Auto;    // avg_pool2d(): window sums or a summed-area table
+};
+
+// Argmax of each output element as h * W + w within its input plane, plus the input shape
+struct MaxPoolIndices {
+    std::vector<std::int32_t> index;
+    Eigen::Index batch = 0;
+    Eigen::Index channels = 0;
+    Eigen::Index height = 0;
+    Eigen::Index width = 0;
+    PoolLayout layout = PoolLayout::NCHW;
+};
+
+// One spatial axis of a pool: output count, and the clipped input range of each window
+struct PoolAxis {
+    Eigen::Index in = 0;
+    Eigen::Index out = 0;
+    Eigen::Index size = 0;
+    Eigen::Index stride = 0;
+    Eigen::Index pad = 0;    // padding before the first window
+
+    Eigen::Index begin(Eigen::Index o) const { return std::max<Eigen::Index>(o * stride - pad, 0); }
+    Eigen::Index end(Eigen::Index o) const { return std::min(o * stride - pad + size, in); }
+
+    // [inner_begin(), inner_end()): the outputs whose windows need no clipping
+    Eigen::Index inner_begin() const { return std::min((pad + stride - 1) / stride, out); }
+    Eigen::Index inner_end() const {
+        return std::max(inner_begin(), in + pad < size ? Eigen::Index(0) : std::min((in + pad - size) / stride + 1, out));
+    }
+};
+
+inline PoolAxis pool_axis(Eigen::Index in, Eigen::Index size, Eigen::Index stride, PoolPadding padding, Eigen::Index pad) {
+    if (size < 1 || stride < 1) throw std::invalid_argument("Pool size and stride must be positive");
+    if (in < 1) throw std::invalid_argument("Empty pooling input");
+
+    PoolAxis axis;
+    axis.in = in;
+    axis.size = size;
+    axis.stride = stride;
+    switch (padding) {
+        case PoolPadding::Valid:
+            if (in < size) throw std::invalid_argument("Pool window larger than input");
+            axis.out = (in - size) / stride + 1;
+            break;
+        case PoolPadding::Same:
+            axis.out = (in + stride - 1) / stride;
+            axis.pad = std::max<Eigen::Index>((axis.out - 1) * stride + size - in, 0) / 2;
+            break;
+        case PoolPadding::Explicit:
+            if (pad < 0 || pad >= size) throw std::invalid_argument("Pool padding must be smaller than the window");
+            if (in + 2 * pad < size) throw std::invalid_argument("Pool window larger than padded input");
+            axis.out = (in + 2 * pad - size) / stride + 1;
+            axis.pad = pad;
+            break;
+    }
+    return axis;
+}
+
+// Logical N, C, H, W of a pooling input in either layout
+struct PoolShape {
+    Eigen::Index N, C, H, W;
+};
+
+template <typename T>
+PoolShape pool_shape(const PoolTensor<T> &input, PoolLayout layout) {
+    if (layout == PoolLayout::NCHW) return {input.dimension(0), input.dimension(1), input.dimension(2), input.dimension(3)};
+    return {input.dimension(0), input.dimension(3), input.dimension(1), input.dimension(2)};
+}
+
+template <typename T>
+PoolTensor<T> pool_allocate(const PoolShape &s, Eigen::Index OH, Eigen::Index OW, PoolLayout layout) {
+    if (layout == PoolLayout::NCHW) return PoolTensor<T>(s.N, s.C, OH, OW);
+    return PoolTensor<T>(s.N, OH, OW, s.C);
+}
+
+template <typename T>
+T pool_divisor(const Pool2DOptions &o, Eigen::Index rows, Eigen::Index cols) {
+    return o.count_include_pad ? T(o.size_h * o.size_w) : T(rows * cols);
+}
+
+// One N x C x H x W plane; row_acc and row_which are W-sized scratch
+template <typename T>
+void pool_plane(const T *in, const PoolAxis &ah, const PoolAxis &aw, const Pool2DOptions &o, bool average,
+                T *out, std::int32_t *arg, T *row_acc, T *row_which) {
+    using Row = Eigen::Array<T, Eigen::Dynamic, 1>;
+    using StridedRow = Eigen::Map<const Row, 0, Eigen::InnerStride<>>;
+    const Eigen::Index W = aw.in;
+    Eigen::Map<Row> acc(row_acc, W);
+    for (Eigen::Index oh = 0; oh < ah.out; ++oh) {
+        const Eigen::Index hb = ah.begin(oh), he = ah.end(oh);
+        const T *row = in + hb * W;
+        Eigen::Index h = hb + 1;
+        if (arg != nullptr) {
+            acc = Eigen::Map<const Row>(row, W);
+            std::fill(row_which, row_which + W, T(0));
+        } else if (h < he) {
+            // The first two rows in one pass
+            row += W;
+            ++h;
+            if (average) {
+                acc = Eigen::Map<const Row>(row - W, W) + Eigen::Map<const Row>(row, W);
+            } else {
+                acc = Eigen::Map<const Row>(row - W, W).max(Eigen::Map<const Row>(row, W));
+            }
+        } else {
+            acc = Eigen::Map<const Row>(row, W);
+        }
+
+        for (; h < he; ++h) {
+            row += W;
+            if (average) {
+                acc += Eigen::Map<const Row>(row, W);
+            } else if (arg == nullptr) {
+                acc = acc.max(Eigen::Map<const Row>(row, W));
+            } else {
+                // The winning row is kept as a T so that the select vectorises along with the max
+                const T which = T(h - hb);
+                for (Eigen::Index w = 0; w < W; ++w) {
+                    row_which[w] = row[w] > row_acc[w] ? which : row_which[w];
+                    row_acc[w] = std::max(row_acc[w], row[w]);
+                }
+            }
+        }
+
+        if (arg == nullptr) {
+            // Unclipped windows: as in pooling(), size_w strided maxima (sums) straight into the
+            // output row; only the borders are reduced one window at a time
+            const Eigen::Index lo = aw.inner_begin(), hi = aw.inner_end();
+            if (lo < hi) {
+                const T *first = row_acc + lo * aw.stride - aw.pad;
+                auto column = [&](Eigen::Index j) { return StridedRow(first + j, hi - lo, Eigen::InnerStride<>(aw.stride)); };
+                Eigen::Map<Row> inner(out + lo, hi - lo);
+                Eigen::Index j = 1;
+                if (aw.size == 1) {
+                    inner = column(0);
+                } else if (average) {
+                    inner = column(0) + column(1);
+                    ++j;
+                } else {
+                    inner = column(0).max(column(1));
+                    ++j;
+                }
+                for (; j < aw.size; ++j) {
+                    if (average) {
+                        inner += column(j);
+                    } else {
+                        inner = inner.max(column(j));
+                    }
+                }
+                if (average) inner *= T(1) / pool_divisor<T>(o, he - hb, aw.size);
+            }
+            auto border = [&](Eigen::Index ow) {
+                const Eigen::Index wb = aw.begin(ow), we = aw.end(ow);
+                if (average) {
+                    T sum = row_acc[wb];
+                    for (Eigen::Index w = wb + 1; w < we; ++w) sum += row_acc[w];
+                    out[ow] = sum / pool_divisor<T>(o, he - hb, we - wb);
+                } else {
+                    out[ow] = *std::max_element(row_acc + wb, row_acc + we);
+                }
+            };
+            for (Eigen::Index ow = 0; ow < std::min(lo, aw.out); ++ow) border(ow);
+            for (Eigen::Index ow = std::max(lo, hi); ow < aw.out; ++ow) border(ow);
+        } else {
+            for (Eigen::Index ow = 0; ow < aw.out; ++ow) {
+                const Eigen::Index wb = aw.begin(ow), we = aw.end(ow);
+                Eigen::Index best = wb;
+                for (Eigen::Index w = wb + 1; w < we; ++w) best = row_acc[w] > row_acc[best] ? w : best;
+                out[ow] = row_acc[best];
+                arg[ow] = std::int32_t((hb + Eigen::Index(row_which[best])) * W + best);
+            }
+            arg += aw.out;
+        }
+        out += aw.out;
+    }
+}
+
+// One output row of an N x H x W x C image; which is C-sized scratch
+template <typename T>
+void pool_row_nhwc(const T *image, Eigen::Index C, const PoolAxis &ah, const PoolAxis &aw, Eigen::Index oh,
+                   const Pool2DOptions &o, bool average, T *out, std::int32_t *arg, T *which) {
+    using Vector = Eigen::Array<T, Eigen::Dynamic, 1>;
+    const Eigen::Index W = aw.in;
+    const Eigen::Index hb = ah.begin(oh), he = ah.end(oh);
+
+    for (Eigen::Index ow = 0; ow < aw.out; ++ow, out += C) {
+        const Eigen::Index wb = aw.begin(ow), we = aw.end(ow);
+        const Eigen::Index rows = he - hb;
+        Eigen::Map<Vector> acc(out, C);
+        acc = Eigen::Map<const Vector>(image + (hb * W + wb) * C, C);
+        if (arg != nullptr) std::fill(which, which + C, T(0));
+
+        // Column by column, so that ties go to the leftmost column, then the topmost row
+        for (Eigen::Index w = wb; w < we; ++w)
+        for (Eigen::Index h = (w == wb ? hb + 1 : hb); h < he; ++h) {
+            const T *x = image + (h * W + w) * C;
+            if (average) {
+                acc += Eigen::Map<const Vector>(x, C);
+            } else if (arg == nullptr) {
+                acc = acc.max(Eigen::Map<const Vector>(x, C));
+            } else {
+                const T slot = T((w - wb) * rows + (h - hb));
+                for (Eigen::Index c = 0; c < C; ++c) {
+                    which[c] = x[c] > out[c] ? slot : which[c];
+                    out[c] = std::max(out[c], x[c]);
+                }
+            }
+        }
+
+        if (average) {
+            acc /= pool_divisor<T>(o, rows, we - wb);
+        } else if (arg != nullptr) {
+            for (Eigen::Index c = 0; c < C; ++c, ++arg) {
+                const Eigen::Index slot = Eigen::Index(which[c]);
+                *arg = std::int32_t((hb + slot % rows) * W + wb + slot / rows);
+            }
+        }
+    }
+}
+
+template <typename T>
+PoolTensor<T> pool2d(const PoolTensor<T> &input, const Pool2DOptions &o, bool average, MaxPoolIndices *indices) {
+    const PoolShape s = pool_shape(input, o.layout);
+    const PoolAxis ah = pool_axis(s.H, o.size_h, o.stride_h, o.padding, o.pad_h);
+    const PoolAxis aw = pool_axis(s.W, o.size_w, o.stride_w, o.padding, o.pad_w);
+
+    PoolTensor<T> output = pool_allocate<T>(s, ah.out, aw.out, o.layout);
+    std::int32_t *index = nullptr;
+    if (indices != nullptr) {
+        if (s.H * s.W > std::numeric_limits<std::int32_t>::max()) throw std::invalid_argument("Plane too large for int32 indices");
+        indices->index.resize(output.size());
+        indices->batch = s.N;
+        indices->channels = s.C;
+        indices->height = s.H;
+        indices->width = s.W;
+        indices->layout = o.layout;
+        index = indices->index.data();
+    }
+
+    const Eigen::Index plane_out = ah.out * aw.out;
+    if (o.layout == PoolLayout::NCHW) {
+        parallel_for(s.N * s.C, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> row_acc(s.W), row_which(index != nullptr ? s.W : 0);
+            for (Eigen::Index plane = first; plane < last; ++plane) {
+                pool_plane(input.data() + plane * s.H * s.W, ah, aw, o, average, output.data() + plane * plane_out,
+                           index != nullptr ? index + plane * plane_out : nullptr, row_acc.data(), row_which.data());
+            }
+        });
+    } else {
+        parallel_for(s.N * ah.out, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> which(index != nullptr ? s.C : 0);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index n = task / ah.out, oh = task % ah.out;
+                const Eigen::Index offset = task * aw.out * s.C;
+                pool_row_nhwc(input.data() + n * s.H * s.W * s.C, s.C, ah, aw, oh, o, average, output.data() + offset,
+                              index != nullptr ? index + offset : nullptr, which.data());
+            }
+        });
+    }
+    return output;
+}
+
+template <typename T>
+PoolTensor<T> max_pool2d(const PoolTensor<T> &input, const Pool2DOptions &options = Pool2DOptions(),
+                         MaxPoolIndices *indices = nullptr) {
+    return pool2d(input, options, false, indices);
+}
+
+/*
+    Average pooling from summed-area tables (summed_area.hpp): O(1) per
+    output whatever the window, against O(size_h + size_w) per output for
+    the direct NCHW path and O(size_h * size_w) for the direct NHWC one,
+    for the price of building the table (a few passes over the input).
+
+    PoolMethod::Auto estimates both costs per channel plane and takes the
+    cheaper one. The direct path is counted in vectorised accumulations;
+    INTEGRAL_COST_* is the measured cost of one table entry or one output
+    (double, partly serial, four scattered reads) in the same unit, per
+    layout: NHWC accumulations are whole C-vectors and its tables are
+    interleaved over 16 channels, so both sides of its ratio differ from
+    NCHW. On the box filters of integral_pool_benchmark the NCHW crossover
+    is around 9x9, and the NHWC integral path already wins at 3x3.
+*/
+
+constexpr double INTEGRAL_COST_NCHW = 8.0;
+constexpr double INTEGRAL_COST_NHWC = 3.0;
+
+// NHWC channels per summed-area table: tasks are (image, channel block)
+constexpr Eigen::Index INTEGRAL_CHANNEL_BLOCK = 16;
+
+inline bool integral_pays_off(const PoolAxis &ah, const PoolAxis &aw, PoolLayout layout) {
+    const double outputs = double(ah.out) * double(aw.out);
+    const double direct = layout == PoolLayout::NCHW ? double(ah.out) * double(aw.in) * double(ah.size + aw.size)
+                                                     : outputs * double(ah.size) * double(aw.size);
+    const double cost = layout == PoolLayout::NCHW ? INTEGRAL_COST_NCHW : INTEGRAL_COST_NHWC;
+    const double integral = cost * (double(ah.in + 1) * double(aw.in + 1) + outputs);
+    return integral < direct;
+}
+
+// Window averages of `channels` interleaved channels from their summed-area table S; output pixels pixel_stride apart
+template <typename T>
+void integral_average(const SumType *S, Eigen::Index channels, const PoolAxis &ah, const PoolAxis &aw,
+                      const Pool2DOptions &o, T *out, Eigen::Index pixel_stride) {
+    const Eigen::Index ld = (aw.in + 1) * channels;
+    for (Eigen::Index oh = 0; oh < ah.out; ++oh) {
+        const Eigen::Index h0 = ah.begin(oh), h1 = ah.end(oh);
+        const SumType *top = S + h0 * ld;
+        const SumType *bottom = S + h1 * ld;
+        for (Eigen::Index ow = 0; ow < aw.out; ++ow, out += pixel_stride) {
+            const Eigen::Index w0 = aw.begin(ow), w1 = aw.end(ow);
+            const SumType scale = SumType(1) / pool_divisor<SumType>(o, h1 - h0, w1 - w0);
+            const SumType *a = top + w0 * channels, *b = top + w1 * channels;
+            const SumType *c = bottom + w0 * channels, *d = bottom + w1 * channels;
+            for (Eigen::Index k = 0; k < channels; ++k) out[k] = T((d[k] - c[k] - b[k] + a[k]) * scale);
+        }
+    }
+}
+
+template <typename T>
+PoolTensor<T> integral_avg_pool2d(const PoolTensor<T> &input, const Pool2DOptions &o, const PoolAxis &ah,
+                                  const PoolAxis &aw) {
+    const PoolShape s = pool_shape(input, o.layout);
+    PoolTensor<T> output = pool_allocate<T>(s, ah.out, aw.out, o.layout);
+    const Eigen::Index plane_in = s.H * s.W;
+    const Eigen::Index plane_out = ah.out * aw.out;
+
+    if (o.layout == PoolLayout::NCHW) {
+        parallel_for(s.N * s.C, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<SumType> table((s.H + 1) * (s.W + 1));
+            for (Eigen::Index plane = first; plane < last; ++plane) {
+                summed_area_table(input.data() + plane * plane_in, s.H, s.W, 1, 1, table.data());
+                integral_average(table.data(), 1, ah, aw, o, output.data() + plane * plane_out, 1);
+            }
+        });
+    } else {
+        const Eigen::Index blocks = (s.C + INTEGRAL_CHANNEL_BLOCK - 1) / INTEGRAL_CHANNEL_BLOCK;
+        parallel_for(s.N * blocks, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<SumType> table((s.H + 1) * (s.W + 1) * std::min(s.C, INTEGRAL_CHANNEL_BLOCK));
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index n = task / blocks;
+                const Eigen::Index c0 = (task % blocks) * INTEGRAL_CHANNEL_BLOCK;
+                const Eigen::Index cb = std::min(INTEGRAL_CHANNEL_BLOCK, s.C - c0);
+                summed_area_table(input.data() + n * plane_in * s.C + c0, s.H, s.W, s.C, cb, table.data());
+                integral_average(table.data(), cb, ah, aw, o, output.data() + n * plane_out * s.C + c0, s.C);
+            }
+        });
+    }
+    return output;
+}
+
+template <typename T>
+PoolTensor<T> avg_pool2d(const PoolTensor<T> &input, const Pool2DOptions &options = Pool2DOptions()) {
+    const PoolShape s = pool_shape(input, options.layout);
+    const PoolAxis ah = pool_axis(s.H, options.size_h, options.stride_h, options.padding, options.pad_h);
+    const PoolAxis aw = pool_axis(s.W, options.size_w, options.stride_w, options.padding, options.pad_w);
+    const bool integral = options.method == PoolMethod::Integral ||
+                          (options.method == PoolMethod::Auto && integral_pays_off(ah, aw, options.layout));
+    return integral ? integral_avg_pool2d(input, options, ah, aw) : pool2d(input, options, true, nullptr);
+}
+
+// Mean over the size_h x size_w neighbourhood of every pixel, clipped at the borders: a same-size avg_pool2d()
+template <typename T>
+PoolTensor<T> box_filter(const PoolTensor<T> &input, Eigen::Index size_h, Eigen::Index size_w,
+                         PoolLayout layout = PoolLayout::NCHW, PoolMethod method = PoolMethod::Auto) {
+    Pool2DOptions options;
+    options.size_h = size_h;
+    options.size_w = size_w;
+    options.stride_h = options.stride_w = 1;
+    options.padding = PoolPadding::Same;
+    options.layout = layout;
+    options.method = method;
+    return avg_pool2d(input, options);
+}
+
+// Mean over each channel's H x W plane: N x C x 1 x 1 (NCHW) or N x 1 x 1 x C (NHWC)
+template <typename T>
+PoolTensor<T> global_avg_pool2d(const PoolTensor<T> &input, PoolLayout layout = PoolLayout::NCHW) {
+    using Vector = Eigen::Array<T, Eigen::Dynamic, 1>;
+    const PoolShape s = pool_shape(input, layout);
+    const Eigen::Index plane = s.H * s.W;
+    if (plane == 0) throw std::invalid_argument("Empty pooling input");
+
+    PoolTensor<T> output = pool_allocate<T>(s, 1, 1, layout);
+    if (layout == PoolLayout::NCHW) {
+        parallel_for(s.N * s.C, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index p = first; p < last; ++p) {
+                output.data()[p] = Eigen::Map<const Vector>(input.data() + p * plane, plane).sum() / T(plane);
+            }
+        });
+    } else {
+        parallel_for(s.N, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index n = first; n < last; ++n) {
+                Eigen::Map<Vector> acc(output.data() + n * s.C, s.C);
+                const T *image = input.data() + n * plane * s.C;
+                acc.setZero();
+                for (Eigen::Index i = 0; i < plane; ++i) acc += Eigen::Map<const Vector>(image + i * s.C, s.C);
+                acc /= T(plane);
+            }
+        });
+    }
+    return output;
+}
+
+// Gradient of max_pool2d() w.r.t. its input: each output gradient added at its window's argmax
+template <typename T>
+PoolTensor<T> max_pool2d_backward(const PoolTensor<T> &grad_output, const MaxPoolIndices &indices) {
+    const Eigen::Index N = indices.batch, C = indices.channels;
+    const bool nchw = indices.layout == PoolLayout::NCHW;
+    if (grad_output.dimension(0) != N || grad_output.dimension(nchw ? 1 : 3) != C ||
+        Eigen::Index(indices.index.size()) != grad_output.size()) {
+        throw std::invalid_argument("Gradient does not match the recorded indices");
+    }
+    const Eigen::Index plane_in = indices.height * indices.width;
+    const Eigen::Index plane_out = grad_output.size() / std::max<Eigen::Index>(N * C, 1);
+    const std::int32_t *index = indices.index.data();
+
+    PoolTensor<T> grad_input = nchw ? PoolTensor<T>(N, C, indices.height, indices.width)
+                                    : PoolTensor<T>(N, indices.height, indices.width, C);
+    grad_input.setZero();
+    // Overlapping windows can share an argmax, hence +=
+    if (nchw) {
+        parallel_for(N * C, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index plane = first; plane < last; ++plane) {
+                T *grad = grad_input.data() + plane * plane_in;
+                const T *delta = grad_output.data() + plane * plane_out;
+                const std::int32_t *arg = index + plane * plane_out;
+                for (Eigen::Index i = 0; i < plane_out; ++i) grad[arg[i]] += delta[i];
+            }
+        });
+    } else {
+        // Tasks are (image, block of channels), so that one image still spreads over the threads
+        const Eigen::Index blocks = std::min(C, (get_num_threads() + N - 1) / std::max<Eigen::Index>(N, 1));
+        parallel_for(N * blocks, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index n = task / blocks, block = task % blocks;
+                const Eigen::Index c_begin = block * C / blocks, c_end = (block + 1) * C / blocks;
+                T *grad = grad_input.data() + n * plane_in * C;
+                const T *delta = grad_output.data() + n * plane_out * C;
+                const std::int32_t *arg = index + n * plane_out * C;
+                for (Eigen::Index i = 0; i < plane_out; ++i, delta += C, arg += C) {
+                    for (Eigen::Index c = c_begin; c < c_end; ++c) grad[arg[c] * C + c] += delta[c];
+                }
+            }
+        });
+    }
+    return grad_input;
+}
+
+#endif
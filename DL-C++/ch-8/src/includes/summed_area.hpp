@@ -0,0 +1,117 @@
+#ifndef __MY_SUMMED_AREA__
+#define __MY_SUMMED_AREA__
+
+#include <algorithm>
+#include <Eigen/Core>
+
+/*
+    Summed-area tables (integral images): for an H x W image x,
+        S[h][w] = sum of x[i][j] over i < h, j < w,     0 <= h <= H, 0 <= w <= W
+    so that the sum over any window [h0, h1) x [w0, w1) is four lookups:
+        S[h1][w1] - S[h0][w1] - S[h1][w0] + S[h0][w0]
+
+    S is (H + 1) x (W + 1) x channels, row-major, with a zero first row and
+    column. It is accumulated in double whatever the input type: the
+    entries grow with the image while window sums are differences of them,
+    and float would lose the low bits of every window far from the origin.
+
+    The input is read with a pixel stride, so the same kernel builds one
+    table per NCHW plane (stride 1, 1 channel) or one interleaved table for
+    a run of NHWC channels (stride C). It runs in two passes:
+        1. column prefix sums, S[h + 1] = S[h] + x[h], an add of contiguous
+           rows (packet-wide);
+        2. row prefix sums, in place. With several channels each pixel adds
+           its left neighbour's contiguous channel vector. With one channel
+           the scan is serial along the row, so PS rows (one packet) are
+           scanned together: a PS x PS block is transposed in registers with
+           ptranspose, so each packet holds one column of the PS rows, the
+           packets are added up in order behind a running packet, and the
+           block is transposed back.
+*/
+
+using SumType = double;
+
+// PacketBlock<__m128d, 2> drops the vector type's alignment attribute, which is harmless here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+// In-place inclusive prefix sums along `count` rows of length `length` (leading dimension ld), PS rows at a time
+inline void scan_rows(SumType *rows, Eigen::Index count, Eigen::Index length, Eigen::Index ld) {
+    using namespace Eigen::internal;
+    using Packet = typename packet_traits<SumType>::type;
+    constexpr Eigen::Index PS = packet_traits<SumType>::size;
+
+    Eigen::Index r = 0;
+    if constexpr (PS > 1) {
+        for (; r + PS <= count; r += PS) {
+            SumType *block_rows = rows + r * ld;
+            Packet carry = pset1<Packet>(SumType(0));
+            Eigen::Index j = 0;
+            for (; j + PS <= length; j += PS) {
+                PacketBlock<Packet, PS> block;
+                for (Eigen::Index k = 0; k < PS; ++k) block.packet[k] = ploadu<Packet>(block_rows + k * ld + j);
+                ptranspose(block);
+                for (Eigen::Index k = 0; k < PS; ++k) {
+                    carry = padd(carry, block.packet[k]);
+                    block.packet[k] = carry;
+                }
+                ptranspose(block);
+                for (Eigen::Index k = 0; k < PS; ++k) pstoreu(block_rows + k * ld + j, block.packet[k]);
+            }
+            for (Eigen::Index k = 0; k < PS; ++k) {
+                SumType *row = block_rows + k * ld;
+                for (Eigen::Index w = std::max<Eigen::Index>(j, 1); w < length; ++w) row[w] += row[w - 1];
+            }
+        }
+    }
+    for (; r < count; ++r) {
+        SumType *row = rows + r * ld;
+        for (Eigen::Index w = 1; w < length; ++w) row[w] += row[w - 1];
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+/*
+    S ((H + 1) x (W + 1) x channels) = summed-area table of the channels
+    x[(h * W + w) * pixel_stride + c], c < channels.
+*/
+template <typename T>
+void summed_area_table(const T *x, Eigen::Index H, Eigen::Index W, Eigen::Index pixel_stride, Eigen::Index channels,
+                       SumType *S) {
+    const Eigen::Index ld = (W + 1) * channels;
+    std::fill(S, S + ld, SumType(0));
+    for (Eigen::Index h = 0; h < H; ++h) {
+        const SumType *above = S + h * ld + channels;
+        SumType *row = S + (h + 1) * ld;
+        const T *in = x + h * W * pixel_stride;
+        std::fill(row, row + channels, SumType(0));
+        row += channels;
+        if (pixel_stride == channels) {
+            for (Eigen::Index i = 0; i < W * channels; ++i) row[i] = above[i] + SumType(in[i]);
+        } else {
+            for (Eigen::Index w = 0; w < W; ++w, row += channels, above += channels, in += pixel_stride) {
+                for (Eigen::Index c = 0; c < channels; ++c) row[c] = above[c] + SumType(in[c]);
+            }
+        }
+    }
+
+    if (channels == 1) {
+        scan_rows(S + ld + 1, H, W, ld);
+        return;
+    }
+    for (Eigen::Index h = 1; h <= H; ++h) {
+        SumType *row = S + h * ld + channels;
+        for (Eigen::Index w = 1; w < W; ++w) {
+            SumType *pixel = row + w * channels;
+            const SumType *left = pixel - channels;
+            for (Eigen::Index c = 0; c < channels; ++c) pixel[c] += left[c];
+        }
+    }
+}
+
+#endif
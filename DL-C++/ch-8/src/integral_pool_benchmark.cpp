@@ -0,0 +1,111 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/pooling.hpp"
+
+/*
+    Summed-area tables against a plain double loop, integral average
+    pooling against the direct path for every padding mode and layout, then
+    box filters of growing size on a 4 x 16 x 256 x 256 float batch: direct
+    and integral timings side by side, and the path PoolMethod::Auto picks.
+*/
+
+using Tensor4D = PoolTensor<float>;
+
+template <typename Fn>
+double best_time_ms(Fn &&fn, int repeats = 3) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+float max_diff(const Tensor4D &a, const Tensor4D &b) {
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (a - b).abs().maximum();
+    return diff();
+}
+
+void check_table(Eigen::Index H, Eigen::Index W, Eigen::Index C) {
+    std::vector<float> x(H * W * C);
+    for (auto &v : x) v = float(std::rand()) / RAND_MAX;
+    std::vector<SumType> S((H + 1) * (W + 1) * C);
+    summed_area_table(x.data(), H, W, C, C, S.data());
+
+    double worst = 0;
+    for (Eigen::Index c = 0; c < C; ++c)
+    for (Eigen::Index h = 0; h <= H; ++h) {
+        double column = 0;
+        for (Eigen::Index w = 0; w <= W; ++w) {
+            if (w > 0) {
+                for (Eigen::Index i = 0; i < h; ++i) column += x[(i * W + w - 1) * C + c];
+            }
+            worst = std::max(worst, std::abs(S[(h * (W + 1) + w) * C + c] - column));
+        }
+    }
+    std::cout << "summed-area table " << H << " x " << W << " x " << C << ": max |diff| " << worst << std::endl;
+}
+
+void check_pool(const char *name, Pool2DOptions o) {
+    Tensor4D x(2, 19, 23, 17);
+    x.setRandom();
+    std::cout << std::left << std::setw(28) << name << std::right;
+    for (PoolLayout layout : {PoolLayout::NCHW, PoolLayout::NHWC}) {
+        o.layout = layout;
+        const Tensor4D input = layout == PoolLayout::NCHW ? x : Tensor4D(x.shuffle(Eigen::array<int, 4>{{0, 2, 3, 1}}));
+        o.method = PoolMethod::Direct;
+        const Tensor4D direct = avg_pool2d(input, o);
+        o.method = PoolMethod::Integral;
+        const Tensor4D integral = avg_pool2d(input, o);
+        std::cout << (layout == PoolLayout::NCHW ? "NCHW" : "   NHWC") << " max |diff| " << max_diff(direct, integral);
+    }
+    std::cout << std::endl;
+}
+
+int main() {
+    check_table(37, 53, 1);
+    check_table(16, 19, 5);
+
+    std::cout << std::endl << "Integral against direct average pooling" << std::endl;
+    Pool2DOptions valid;
+    valid.size_h = valid.size_w = 7;
+    valid.stride_h = valid.stride_w = 3;
+    check_pool("7x7/3 valid", valid);
+    Pool2DOptions same;
+    same.size_h = 9;
+    same.size_w = 4;
+    same.stride_h = same.stride_w = 1;
+    same.padding = PoolPadding::Same;
+    check_pool("9x4/1 same", same);
+    Pool2DOptions padded;
+    padded.size_h = padded.size_w = 5;
+    padded.stride_h = padded.stride_w = 2;
+    padded.padding = PoolPadding::Explicit;
+    padded.pad_h = padded.pad_w = 2;
+    padded.count_include_pad = true;
+    check_pool("5x5/2 pad 2, include pad", padded);
+
+    Tensor4D x(4, 16, 256, 256);
+    x.setRandom();
+    const Tensor4D x_nhwc = x.shuffle(Eigen::array<int, 4>{{0, 2, 3, 1}});
+    std::cout << std::endl << "box_filter on 4 x 16 x 256 x 256 float" << std::endl;
+    std::cout << "window   layout  direct ms  integral ms  auto" << std::endl;
+    for (Eigen::Index k : {3, 5, 9, 17, 33, 65}) {
+        for (PoolLayout layout : {PoolLayout::NCHW, PoolLayout::NHWC}) {
+            const Tensor4D &input = layout == PoolLayout::NCHW ? x : x_nhwc;
+            const double direct_ms = best_time_ms([&] { box_filter(input, k, k, layout, PoolMethod::Direct); });
+            const double integral_ms = best_time_ms([&] { box_filter(input, k, k, layout, PoolMethod::Integral); });
+            PoolAxis axis = pool_axis(256, k, 1, PoolPadding::Same, 0);
+            std::cout << std::left << std::setw(9) << (std::to_string(k) + "x" + std::to_string(k))
+                      << std::setw(6) << (layout == PoolLayout::NCHW ? "NCHW" : "NHWC") << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(11) << direct_ms << std::setw(13) << integral_ms
+                      << std::defaultfloat << "  " << (integral_pays_off(axis, axis, layout) ? "integral" : "direct")
+                      << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <iostream>
+#include "includes/pooling.hpp"
+
+/*
+    Batched max_pool2d() and its argmax-driven backward pass against plain
+    loops, then timed on a 32 x 64 x 112 x 112 activation: the scatter
+    backward against a backward that searches every window again for its
+    maximum.
+*/
+
+using Tensor4D = PoolTensor<float>;
+
+Tensor4D reference_max_pool(const Tensor4D &x, const Pool2DOptions &o) {
+    const Eigen::Index PH = (x.dimension(2) - o.size_h) / o.stride_h + 1;
+    const Eigen::Index PW = (x.dimension(3) - o.size_w) / o.stride_w + 1;
+    Tensor4D out(x.dimension(0), x.dimension(1), PH, PW);
+    for (Eigen::Index n = 0; n < x.dimension(0); ++n)
+    for (Eigen::Index c = 0; c < x.dimension(1); ++c)
+    for (Eigen::Index ph = 0; ph < PH; ++ph)
+    for (Eigen::Index pw = 0; pw < PW; ++pw) {
+        float best = x(n, c, ph * o.stride_h, pw * o.stride_w);
+        for (Eigen::Index i = 0; i < o.size_h; ++i)
+        for (Eigen::Index j = 0; j < o.size_w; ++j) best = std::max(best, x(n, c, ph * o.stride_h + i, pw * o.stride_w + j));
+        out(n, c, ph, pw) = best;
+    }
+    return out;
+}
+
+// The backward pass without indices: find each window's maximum again, then route its gradient there
+Tensor4D search_backward(const Tensor4D &x, const Tensor4D &grad_output, const Pool2DOptions &o) {
+    Tensor4D grad(x.dimensions());
+    grad.setZero();
+    for (Eigen::Index n = 0; n < x.dimension(0); ++n)
+    for (Eigen::Index c = 0; c < x.dimension(1); ++c)
+    for (Eigen::Index ph = 0; ph < grad_output.dimension(2); ++ph)
+    for (Eigen::Index pw = 0; pw < grad_output.dimension(3); ++pw) {
+        Eigen::Index best_h = ph * o.stride_h, best_w = pw * o.stride_w;
+        for (Eigen::Index j = 0; j < o.size_w; ++j)
+        for (Eigen::Index i = 0; i < o.size_h; ++i) {
+            const Eigen::Index h = ph * o.stride_h + i, w = pw * o.stride_w + j;
+            if (x(n, c, h, w) > x(n, c, best_h, best_w)) {
+                best_h = h;
+                best_w = w;
+            }
+        }
+        grad(n, c, best_h, best_w) += grad_output(n, c, ph, pw);
+    }
+    return grad;
+}
+
+template <typename Fn>
+double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+void check(const char *name, const Pool2DOptions &options) {
+    Tensor4D x(3, 5, 13, 11);
+    x.setRandom();
+    MaxPoolIndices indices;
+    Tensor4D y = max_pool2d(x, options, &indices);
+    Tensor4D grad_output(y.dimensions());
+    grad_output.setRandom();
+    Tensor4D grad = max_pool2d_backward(grad_output, indices);
+
+    Eigen::Tensor<float, 0, Eigen::RowMajor> forward_diff = (y - reference_max_pool(x, options)).abs().maximum();
+    Eigen::Tensor<float, 0, Eigen::RowMajor> plain_diff = (y - max_pool2d(x, options)).abs().maximum();
+    Eigen::Tensor<float, 0, Eigen::RowMajor> backward_diff = (grad - search_backward(x, grad_output, options)).abs().maximum();
+    std::cout << name << ": output " << y.dimension(2) << "x" << y.dimension(3) << ", max |diff| forward "
+              << forward_diff() << " (without indices " << plain_diff() << "), backward " << backward_diff() << std::endl;
+}
+
+int main() {
+    std::cout << "max_pool2d and max_pool2d_backward against plain loops" << std::endl;
+    check("2x2, stride 2", Pool2DOptions());
+    Pool2DOptions overlapping;
+    overlapping.size_h = overlapping.size_w = 3;
+    check("3x3, stride 2", overlapping);
+    Pool2DOptions tall;
+    tall.size_h = 4;
+    tall.size_w = 2;
+    tall.stride_h = 3;
+    tall.stride_w = 1;
+    check("4x2, stride 3x1", tall);
+
+    Tensor4D x(32, 64, 112, 112);
+    x.setRandom();
+    Pool2DOptions options;
+    options.size_h = options.size_w = 3;
+    MaxPoolIndices indices;
+    Tensor4D y = max_pool2d(x, options, &indices);
+    Tensor4D grad_output(y.dimensions());
+    grad_output.setRandom();
+
+    std::cout << std::endl << "32x64x112x112, 3x3 max-pool, stride 2 ("
+              << indices.index.size() * sizeof(std::int32_t) / (1024.0 * 1024.0) << " MB of int32 indices)" << std::endl;
+    for (int threads : {1, get_num_threads()}) {
+        set_num_threads(threads);
+        Tensor4D out, grad;
+        const double plain_ms = time_ms([&] { out = max_pool2d(x, options); });
+        const double indexed_ms = time_ms([&] { out = max_pool2d(x, options, &indices); });
+        const double scatter_ms = time_ms([&] { grad = max_pool2d_backward(grad_output, indices); });
+        std::cout << threads << " thread(s): forward " << plain_ms << " ms, with indices " << indexed_ms
+                  << " ms, scatter backward " << scatter_ms << " ms" << std::endl;
+    }
+    set_num_threads(0);
+    const double search_ms = time_ms([&] { search_backward(x, grad_output, options); });
+    std::cout << "backward searching the windows again: " << search_ms << " ms" << std::endl;
+    return 0;
+}
@@ -1,33 +1,13 @@
-const Eigen::Tensor<T, 2> pooling(const Eigen::Tensor<T, 2>&x, int pool_size, int stride = 1){
-    
-    //reshaping the input to a 4-Rank shape (depth, rows, columns, batch)
-    Eigen::array<Eigen::DenseIndex, 4> reshaped_dims{{1,x.dimension(0),x.dimension(1),1}};
-    Eigen::Tensor<T, 4> reshaped_input = x.reshape(reshaped_dims);
-
-    //getting the patches
-    Eigen::Tensor<T, 5> patches =
-    reshaped_input.extract_image_patches(
-        pool_size, pool_size,   // kernel height & width
-        stride, stride,         // stride height & width
-        Eigen::PADDING_VALID    // no zero-padding
-    );
-    
-    //Getting the max of each patch (reduce over kernel dimensions)
-    Eigen::array<Eigen::DenseIndex, 2> dims({1, 2});
-    Eigen::Tensor<T, 3> maxed_patches = patches.maximum(dims);
-    
-    //Reshape back to 2D by removing depth and batch dimensions
-    //Reshape back to 2D using correct pooling output dimensions
-    int output_rows = (x.dimension(0) - pool_size) / stride + 1;
-    int output_cols = (x.dimension(1) - pool_size) / stride + 1;
-    Eigen::array<Eigen::DenseIndex, 2> output_dims{{output_rows, output_cols}};
-    auto result = maxed_patches.reshape(output_dims);
-
-    return result;
-}
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "includes/pooling.hpp"
 
 /*
-
+    The direct max-pool of includes/pooling.hpp against the original
+    patch-based version, which reshapes the input to rank 4, materialises
+    every window with extract_image_patches and then takes the maximum:
 
     Start:      x                          (R, C)
 
@@ -38,9 +18,59 @@ const Eigen::Tensor<T, 2> pooling(const Eigen::Tensor<T, 2>&x, int pool_size, in
     Reduce:     maxed_patches               (1, P, 1)
 
     Reshape:    result                      (out_rows, out_cols)
+*/
 
+template <typename T>
+Eigen::Tensor<T, 2> pooling_patches(const Eigen::Tensor<T, 2> &x, int pool_size, int stride = 1) {
+    Eigen::array<Eigen::DenseIndex, 4> reshaped_dims{{1, x.dimension(0), x.dimension(1), 1}};
+    Eigen::Tensor<T, 4> reshaped_input = x.reshape(reshaped_dims);
 
-*/
+    // The input strides (1, 1) must be spelled out: passed fifth, PADDING_VALID lands in in_row_stride
+    Eigen::Tensor<T, 5> patches = reshaped_input.extract_image_patches(pool_size, pool_size, stride, stride, 1, 1, Eigen::PADDING_VALID);
 
+    Eigen::array<Eigen::DenseIndex, 2> dims({1, 2});
+    Eigen::Tensor<T, 3> maxed_patches = patches.maximum(dims);
+
+    Eigen::DenseIndex output_rows = (x.dimension(0) - pool_size) / stride + 1;
+    Eigen::DenseIndex output_cols = (x.dimension(1) - pool_size) / stride + 1;
+    Eigen::array<Eigen::DenseIndex, 2> output_dims{{output_rows, output_cols}};
+    return maxed_patches.reshape(output_dims);
+}
 
-*
\ No newline at end of file
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 5; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+int main() {
+    Eigen::Tensor<float, 2> small(4, 6);
+    for (Eigen::Index i = 0; i < small.size(); ++i) small.data()[i] = float((i * 7) % 11);
+    std::cout << "Input (4 x 6):\n" << small << "\n\n";
+    std::cout << "2x2 max-pool, stride 2:\n" << pooling(small, 2, 2) << "\n\n";
+    std::cout << "3x3 max-pool, stride 1:\n" << pooling(small, 3) << "\n\n";
+
+    std::cout << "size          pool/stride  patches ms  direct ms  speedup   match" << std::endl;
+    for (Eigen::Index size : {256, 1024, 2048}) {
+        Eigen::Tensor<float, 2> x(size, size);
+        x.setRandom();
+        for (auto [pool, stride] : {std::pair{2, 2}, std::pair{3, 2}, std::pair{3, 1}}) {
+            Eigen::Tensor<float, 2> expected, result;
+            const double patches_ms = best_time_ms([&] { expected = pooling_patches(x, pool, stride); });
+            const double direct_ms = best_time_ms([&] { result = pooling(x, pool, stride); });
+            Eigen::Tensor<float, 0> diff = (result - expected).abs().maximum();
+
+            std::cout << std::left << std::setw(14) << (std::to_string(size) + " x " + std::to_string(size)) << std::right
+                      << pool << "x" << pool << "/" << stride << std::fixed << std::setprecision(2) << std::setw(17)
+                      << patches_ms << std::setw(11) << direct_ms << std::setw(8) << patches_ms / direct_ms << "x"
+                      << std::setw(8) << (diff() == 0 ? "exact" : "MISMATCH") << std::defaultfloat << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <iostream>
+#include "includes/conv2d_layer.hpp"
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+// Direct seven-loop convolution used as the reference
+Tensor4D reference_conv2d(const Tensor4D &input, const Tensor4D &weights, const Tensor1D &bias, const Conv2DOptions &o) {
+    const Eigen::Index N = input.dimension(0), H = input.dimension(2), W = input.dimension(3);
+    const Eigen::Index K = weights.dimension(0), Cg = weights.dimension(1), R = weights.dimension(2), S = weights.dimension(3);
+    const Eigen::Index Kg = K / o.groups;
+    const Eigen::Index OH = (H + 2 * o.pad_h - o.dilation_h * (R - 1) - 1) / o.stride_h + 1;
+    const Eigen::Index OW = (W + 2 * o.pad_w - o.dilation_w * (S - 1) - 1) / o.stride_w + 1;
+
+    Tensor4D output(N, K, OH, OW);
+    for (Eigen::Index n = 0; n < N; ++n)
+    for (Eigen::Index k = 0; k < K; ++k)
+    for (Eigen::Index oh = 0; oh < OH; ++oh)
+    for (Eigen::Index ow = 0; ow < OW; ++ow) {
+        float sum = bias.size() ? bias(k) : 0.f;
+        for (Eigen::Index c = 0; c < Cg; ++c)
+        for (Eigen::Index r = 0; r < R; ++r)
+        for (Eigen::Index s = 0; s < S; ++s) {
+            const Eigen::Index ih = oh * o.stride_h - o.pad_h + r * o.dilation_h;
+            const Eigen::Index iw = ow * o.stride_w - o.pad_w + s * o.dilation_w;
+            if (ih < 0 || ih >= H || iw < 0 || iw >= W) continue;
+            sum += input(n, (k / Kg) * Cg + c, ih, iw) * weights(k, c, r, s);
+        }
+        output(n, k, oh, ow) = o.activation == Activation::ReLU ? std::max(sum, 0.f) : sum;
+    }
+    return output;
+}
+
+void check(const char *name, Eigen::Index C, Eigen::Index K, Eigen::Index R, const Conv2DOptions &options) {
+    Tensor4D input(2, C, 11, 13);
+    Tensor4D weights(K, C / options.groups, R, R);
+    Tensor1D bias(K);
+    input.setRandom();
+    weights.setRandom();
+    bias.setRandom();
+
+    Conv2D<float> conv(weights, bias, options);
+    Tensor4D output = conv(input);
+    Tensor4D expected = reference_conv2d(input, weights, bias, options);
+
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (output - expected).abs().maximum();
+    std::cout << name << ": output " << output.dimension(0) << "x" << output.dimension(1) << "x"
+              << output.dimension(2) << "x" << output.dimension(3) << ", max |diff| = " << diff() << std::endl;
+}
+
+int main() {
+    std::cout << "Conv2D against the direct loop" << std::endl;
+
+    Conv2DOptions plain;
+    check("3x3, stride 1, no padding     ", 3, 8, 3, plain);
+
+    Conv2DOptions same;
+    same.pad_h = same.pad_w = 1;
+    same.activation = Activation::ReLU;
+    check("3x3, padding 1, ReLU          ", 4, 6, 3, same);
+
+    Conv2DOptions strided;
+    strided.stride_h = strided.stride_w = 2;
+    strided.pad_h = strided.pad_w = 2;
+    check("5x5, stride 2, padding 2      ", 3, 4, 5, strided);
+
+    Conv2DOptions dilated;
+    dilated.dilation_h = dilated.dilation_w = 2;
+    dilated.pad_h = dilated.pad_w = 2;
+    check("3x3, dilation 2, padding 2    ", 2, 5, 3, dilated);
+
+    Conv2DOptions grouped;
+    grouped.groups = 2;
+    grouped.pad_h = grouped.pad_w = 1;
+    check("3x3, 2 groups, padding 1      ", 4, 6, 3, grouped);
+
+    Conv2DOptions pointwise;
+    check("1x1 pointwise                 ", 8, 16, 1, pointwise);
+
+    // A ResNet-style layer: 8 x 64 x 56 x 56 input, 64 3x3 filters, padding 1
+    Tensor4D input(8, 64, 56, 56);
+    Tensor4D weights(64, 64, 3, 3);
+    Tensor1D bias(64);
+    input.setRandom();
+    weights.setRandom();
+    bias.setRandom();
+    Conv2D<float> conv(weights, bias, same);
+
+    std::cout << std::endl << "8x64x56x56 input, 64 3x3 filters, padding 1, ReLU" << std::endl;
+    for (int threads : {1, get_num_threads()}) {
+        set_num_threads(threads);
+        auto start = std::chrono::steady_clock::now();
+        Tensor4D output = conv(input);
+        auto stop = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        double gflops = 2.0 * output.size() * 64 * 9 / (ms * 1e6);
+        std::cout << threads << " thread(s): " << ms << " ms, " << gflops << " GFLOP/s" << std::endl;
+    }
+    set_num_threads(0);
+
+    return 0;
+}
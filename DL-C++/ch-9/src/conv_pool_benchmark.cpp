@@ -0,0 +1,90 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv_pool.hpp"
+
+/*
+    Fused Conv2D -> bias -> ReLU -> max-pool against the unfused stage: the
+    Conv2D layer (bias and ReLU fused) writing its full output, followed by
+    a separate max-pool pass over it with the same pooling code. Both use
+    the algorithm Conv2D selects (Auto), shown per layer; the block only
+    fuses when that is im2col. Times are the best of three runs.
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+struct Layer {
+    Eigen::Index batch, channels, filters, size, kernel, pool;
+};
+
+const char *algorithm_name(ConvAlgorithm algorithm) {
+    switch (algorithm) {
+        case ConvAlgorithm::Im2col: return "im2col";
+        case ConvAlgorithm::Winograd2x2: return "F(2x2)";
+        case ConvAlgorithm::Winograd4x4: return "F(4x4)";
+        case ConvAlgorithm::FFT: return "FFT";
+        case ConvAlgorithm::Direct: return "direct";
+        default: return "auto";
+    }
+}
+
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+int main() {
+    const std::vector<Layer> layers = {
+        {8, 3, 32, 64, 3, 2},
+        {4, 32, 64, 112, 3, 2},
+        {8, 64, 64, 56, 3, 2},
+        {8, 128, 128, 28, 3, 2},
+        {4, 16, 32, 128, 5, 3}};
+
+    std::cout << "layer (N x C x HW, K, kernel, pool)    conv  unfused ms  fused ms  speedup  max |diff|\n";
+    for (const Layer &layer : layers) {
+        Tensor4D input(layer.batch, layer.channels, layer.size, layer.size);
+        Tensor4D weights(layer.filters, layer.channels, layer.kernel, layer.kernel);
+        Tensor1D bias(layer.filters);
+        input.setRandom();
+        weights.setRandom();
+        bias.setRandom();
+
+        Conv2DOptions options;
+        options.pad_h = options.pad_w = layer.kernel / 2;
+        options.activation = Activation::ReLU;
+        MaxPoolOptions pool;
+        pool.size_h = pool.size_w = pool.stride_h = pool.stride_w = layer.pool;
+
+        Conv2D<float> conv(weights, bias, options);
+        Conv2DMaxPool<float> fused(weights, bias, options, pool);
+
+        Tensor4D expected, output;
+        const double unfused_ms = best_time_ms([&] {
+            const Tensor4D activations = conv(input);
+            expected.resize(layer.batch, layer.filters, (activations.dimension(2) - pool.size_h) / pool.stride_h + 1,
+                            (activations.dimension(3) - pool.size_w) / pool.stride_w + 1);
+            max_pool_planes(activations.data(), layer.batch * layer.filters, activations.dimension(2), activations.dimension(3), pool,
+                            expected.data());
+        });
+        const double fused_ms = best_time_ms([&] { output = fused(input); });
+        Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (output - expected).abs().maximum();
+
+        std::cout << std::setw(2) << layer.batch << " x" << std::setw(4) << layer.channels << " x" << std::setw(4) << layer.size
+                  << ", K =" << std::setw(4) << layer.filters << ", " << layer.kernel << "x" << layer.kernel << ", "
+                  << layer.pool << "x" << layer.pool << "/" << layer.pool << std::setw(8)
+                  << algorithm_name(conv.selected_algorithm(layer.size, layer.size)) << std::fixed << std::setprecision(2)
+                  << std::setw(10) << unfused_ms << std::setw(10) << fused_ms << std::setw(8) << unfused_ms / fused_ms << "x"
+                  << std::scientific << std::setprecision(1) << std::setw(11) << diff() << std::defaultfloat << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <chrono>
+#include <iostream>
+#include "includes/conv2d_backward.hpp"
+#include "includes/conv_transpose.hpp"
+
+/*
+    ConvTranspose2D against a direct scatter loop, and against the input
+    gradient of the Conv2D it transposes (the two are the same linear map),
+    then timed on a decoder-style 2x upsampling layer.
+*/
+
+using Tensor4D = ConvTranspose2D<float>::Tensor4D;
+using Tensor1D = ConvTranspose2D<float>::Tensor1D;
+
+// out[n, k, ih * s - p + r * d, iw * s - p + c * d] += x[n, c, ih, iw] * w[c, k, r, s]
+Tensor4D reference_conv_transpose(const Tensor4D &input, const ConvTranspose2D<float> &layer) {
+    const ConvTranspose2DOptions &o = layer.settings();
+    const Tensor4D &w = layer.kernels();
+    const ConvGeometry g = layer.geometry(input);
+    const Eigen::Index N = input.dimension(0), C = input.dimension(1), H = input.dimension(2), W = input.dimension(3);
+    const Eigen::Index Cg = C / o.groups, Kg = w.dimension(1);
+
+    Tensor4D output(N, Kg * o.groups, g.height, g.width);
+    output.setZero();
+    for (Eigen::Index n = 0; n < N; ++n)
+    for (Eigen::Index c = 0; c < C; ++c)
+    for (Eigen::Index ih = 0; ih < H; ++ih)
+    for (Eigen::Index iw = 0; iw < W; ++iw)
+    for (Eigen::Index k = 0; k < Kg; ++k)
+    for (Eigen::Index r = 0; r < g.kernel_h; ++r)
+    for (Eigen::Index s = 0; s < g.kernel_w; ++s) {
+        const Eigen::Index oh = ih * o.stride_h - o.pad_h + r * o.dilation_h;
+        const Eigen::Index ow = iw * o.stride_w - o.pad_w + s * o.dilation_w;
+        if (oh < 0 || oh >= g.height || ow < 0 || ow >= g.width) continue;
+        output(n, (c / Cg) * Kg + k, oh, ow) += input(n, c, ih, iw) * w(c, k, r, s);
+    }
+    for (Eigen::Index n = 0; n < N; ++n)
+    for (Eigen::Index k = 0; k < output.dimension(1); ++k)
+    for (Eigen::Index oh = 0; oh < g.height; ++oh)
+    for (Eigen::Index ow = 0; ow < g.width; ++ow) {
+        output(n, k, oh, ow) += layer.biases()(k);
+    }
+    return output;
+}
+
+void check(const char *name, Eigen::Index C, Eigen::Index K, Eigen::Index R, const ConvTranspose2DOptions &options) {
+    Tensor4D input(2, C, 6, 7);
+    Tensor4D weights(C, K / options.groups, R, R);
+    Tensor1D bias(K);
+    input.setRandom();
+    weights.setRandom();
+    bias.setRandom();
+
+    ConvTranspose2D<float> layer(weights, bias, options);
+    Tensor4D output = layer(input);
+    Tensor4D expected = reference_conv_transpose(input, layer);
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (output - expected).abs().maximum();
+
+    // The forward convolution that maps our output shape back to our input shape
+    Conv2DOptions forward;
+    forward.stride_h = options.stride_h;
+    forward.stride_w = options.stride_w;
+    forward.pad_h = options.pad_h;
+    forward.pad_w = options.pad_w;
+    forward.dilation_h = options.dilation_h;
+    forward.dilation_w = options.dilation_w;
+    forward.groups = options.groups;
+    Conv2D<float> conv(weights, Tensor1D(), forward);
+    Tensor4D unbiased = ConvTranspose2D<float>(weights, Tensor1D(), options)(input);
+    Tensor4D adjoint = conv2d_backward(conv, unbiased, Tensor4D(), input).input;
+    Eigen::Tensor<float, 0, Eigen::RowMajor> adjoint_diff = (unbiased - adjoint).abs().maximum();
+
+    std::cout << name << ": output " << output.dimension(1) << "x" << output.dimension(2) << "x" << output.dimension(3)
+              << ", max |diff| loop " << diff() << ", Conv2D input gradient " << adjoint_diff() << std::endl;
+}
+
+int main() {
+    std::cout << "ConvTranspose2D against the scatter loop and the Conv2D input gradient" << std::endl;
+
+    ConvTranspose2DOptions plain;
+    check("3x3, stride 1                 ", 3, 4, 3, plain);
+
+    ConvTranspose2DOptions up;
+    up.stride_h = up.stride_w = 2;
+    up.pad_h = up.pad_w = 1;
+    up.output_pad_h = up.output_pad_w = 1;
+    check("3x3, stride 2, pad 1, out pad 1", 4, 3, 3, up);
+
+    ConvTranspose2DOptions exact;
+    exact.stride_h = exact.stride_w = 2;
+    check("2x2, stride 2                 ", 5, 6, 2, exact);
+
+    ConvTranspose2DOptions wide;
+    wide.stride_h = wide.stride_w = 3;
+    wide.pad_h = wide.pad_w = 2;
+    wide.dilation_h = wide.dilation_w = 2;
+    wide.output_pad_h = 2;
+    check("4x4, stride 3, dilation 2     ", 2, 3, 4, wide);
+
+    ConvTranspose2DOptions grouped;
+    grouped.groups = 2;
+    grouped.stride_h = grouped.stride_w = 2;
+    grouped.pad_h = grouped.pad_w = 1;
+    check("4x4, stride 2, 2 groups       ", 4, 6, 4, grouped);
+
+    // Decoder stage: 8 x 128 x 28 x 28 -> 8 x 64 x 56 x 56, 4x4 filters, stride 2, padding 1, ReLU
+    ConvTranspose2DOptions decoder;
+    decoder.stride_h = decoder.stride_w = 2;
+    decoder.pad_h = decoder.pad_w = 1;
+    decoder.activation = Activation::ReLU;
+    Tensor4D input(8, 128, 28, 28), weights(128, 64, 4, 4);
+    Tensor1D bias(64);
+    input.setRandom();
+    weights.setRandom();
+    bias.setRandom();
+    ConvTranspose2D<float> layer(weights, bias, decoder);
+
+    std::cout << std::endl << "8x128x28x28 -> 8x64x56x56, 4x4 filters, stride 2, padding 1, ReLU" << std::endl;
+    for (int threads : {1, get_num_threads()}) {
+        set_num_threads(threads);
+        auto start = std::chrono::steady_clock::now();
+        Tensor4D output = layer(input);
+        auto stop = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        double gflops = 2.0 * input.size() * 64 * 16 / (ms * 1e6);
+        std::cout << threads << " thread(s): " << ms << " ms, " << gflops << " GFLOP/s" << std::endl;
+    }
+    set_num_threads(0);
+
+    return 0;
+}
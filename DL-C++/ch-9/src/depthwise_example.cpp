@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv2d_layer.hpp"
+#include "includes/depthwise.hpp"
+
+/*
+    Depthwise (NHWC) and fused depthwise-separable kernels, checked against
+    Conv2D with groups = C on NCHW tensors, and timed against it on
+    MobileNet-style layers.
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor3D = DepthwiseConv2D<float>::Tensor3D;
+using Tensor2D = DepthwiseSeparableConv2D<float>::Tensor2D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+const Eigen::array<int, 4> NCHW_TO_NHWC = {0, 2, 3, 1};
+const Eigen::array<int, 4> NHWC_TO_NCHW = {0, 3, 1, 2};
+
+// R x S x C depthwise weights as the C x 1 x R x S filters of a grouped Conv2D
+Tensor4D grouped_filters(const Tensor3D &weights) {
+    const Eigen::array<int, 3> to_crs = {2, 0, 1};
+    Tensor3D crs = weights.shuffle(to_crs);
+    return crs.reshape(Eigen::array<Eigen::Index, 4>{weights.dimension(2), 1, weights.dimension(0), weights.dimension(1)});
+}
+
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+// max |a - b| / max |b|
+float relative_error(const Tensor4D &a, const Tensor4D &b) {
+    Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (a - b).abs().maximum();
+    Eigen::Tensor<float, 0, Eigen::RowMajor> scale = b.abs().maximum();
+    return diff() / scale();
+}
+
+struct Layer {
+    Eigen::Index batch, channels, size, kernel, stride, filters;
+};
+
+int main() {
+    const std::vector<Layer> layers = {
+        {8, 32, 112, 3, 1, 64}, {8, 128, 56, 3, 2, 128}, {8, 256, 28, 3, 1, 256}, {8, 512, 14, 5, 1, 512}, {2, 24, 33, 7, 1, 32}};
+
+    std::cout << "layer (N x C x H, kernel/stride -> K)  check     grouped im2col  depthwise NHWC  |  im2col dw+pw  fused NHWC\n";
+    for (const Layer &layer : layers) {
+        const Eigen::Index C = layer.channels, K = layer.filters, R = layer.kernel;
+        Tensor4D nchw(layer.batch, C, layer.size, layer.size);
+        Tensor3D dw_weights(R, R, C);
+        Tensor1D dw_bias(C);
+        Tensor2D pw_weights(K, C);
+        Tensor1D pw_bias(K);
+        nchw.setRandom();
+        dw_weights.setRandom();
+        dw_bias.setRandom();
+        pw_weights.setRandom();
+        pw_bias.setRandom();
+        Tensor4D nhwc = nchw.shuffle(NCHW_TO_NHWC);
+
+        DepthwiseOptions dw_options;
+        dw_options.stride_h = dw_options.stride_w = layer.stride;
+        dw_options.pad_h = dw_options.pad_w = R / 2;
+        dw_options.activation = Activation::ReLU;
+        DepthwiseConv2D<float> depthwise(dw_weights, dw_bias, dw_options);
+        DepthwiseSeparableConv2D<float> separable(depthwise, pw_weights, pw_bias, Activation::ReLU);
+
+        Conv2DOptions grouped_options;
+        grouped_options.stride_h = grouped_options.stride_w = layer.stride;
+        grouped_options.pad_h = grouped_options.pad_w = R / 2;
+        grouped_options.groups = C;
+        grouped_options.activation = Activation::ReLU;
+        Conv2D<float> grouped(grouped_filters(dw_weights), dw_bias, grouped_options);
+
+        Conv2DOptions pointwise_options;
+        pointwise_options.activation = Activation::ReLU;
+        Conv2D<float> pointwise(pw_weights.reshape(Eigen::array<Eigen::Index, 4>{K, C, 1, 1}), pw_bias, pointwise_options);
+
+        Tensor4D dw_nhwc = depthwise(nhwc);
+        Tensor4D dw_nchw = grouped(nchw);
+        Tensor4D sep_nhwc = separable(nhwc);
+        Tensor4D sep_nchw = pointwise(dw_nchw);
+        const float dw_error = relative_error(dw_nhwc.shuffle(NHWC_TO_NCHW), dw_nchw);
+        const float sep_error = relative_error(sep_nhwc.shuffle(NHWC_TO_NCHW), sep_nchw);
+
+        std::cout << std::setw(2) << layer.batch << " x" << std::setw(4) << C << " x" << std::setw(4) << layer.size << ", "
+                  << R << "x" << R << "/" << layer.stride << " ->" << std::setw(4) << K
+                  << std::scientific << std::setprecision(1) << "   " << std::max(dw_error, sep_error) << std::defaultfloat
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(15) << best_time_ms([&] { dw_nchw = grouped(nchw); })
+                  << std::setw(16) << best_time_ms([&] { dw_nhwc = depthwise(nhwc); })
+                  << "  |" << std::setw(13) << best_time_ms([&] { sep_nchw = pointwise(grouped(nchw)); })
+                  << std::setw(12) << best_time_ms([&] { sep_nhwc = separable(nhwc); })
+                  << std::defaultfloat << "\n";
+    }
+    std::cout << "(times in ms, best of 3; check is the relative error against the grouped Conv2D)" << std::endl;
+    return 0;
+}
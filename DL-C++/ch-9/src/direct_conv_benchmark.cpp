@@ -0,0 +1,104 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv2d_layer.hpp"
+
+/*
+    im2col + GEMM against the register-tiled direct kernel.
+
+    Time is the best of three runs, for im2col, for the direct kernel behind
+    the NCHW interface (reading NCHW input and writing NCHW output in place)
+    and for the direct kernel alone on data already in NCHW8c, as between two
+    layers that both keep the blocked layout. The error is
+    max |direct - im2col| / max |im2col|.
+
+    Memory is the scratch each path needs on top of input, weights and
+    output: the full patch matrix a one-shot im2col would build, the banded
+    col buffers Conv2D really allocates (one per thread), and the packed
+    filter blocks of the direct path (also one per thread). Pointwise layers have no patches, so
+    ConvAlgorithm::Direct runs them on the GEMM too (marked *).
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+struct Layer {
+    Eigen::Index batch, channels, filters, size, kernel, stride, pad;
+};
+
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+double megabytes(Eigen::Index bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+int main() {
+    const std::vector<Layer> layers = {
+        {1, 3, 64, 224, 7, 2, 3},
+        {1, 64, 64, 56, 3, 1, 1},
+        {1, 64, 128, 56, 3, 2, 1},
+        {1, 128, 128, 28, 3, 1, 1},
+        {1, 256, 256, 14, 3, 1, 1},
+        {1, 256, 64, 56, 1, 1, 0},
+        {8, 32, 32, 32, 3, 1, 1},
+        {1, 32, 32, 112, 5, 1, 2}};
+
+    std::cout << "layer (N x C x HW, K, kernel/stride)  im2col ms  direct ms  blocked ms   rel err"
+              << "   full col MB  banded col MB  direct MB\n";
+    for (const Layer &layer : layers) {
+        Tensor4D input(layer.batch, layer.channels, layer.size, layer.size);
+        Tensor4D weights(layer.filters, layer.channels, layer.kernel, layer.kernel);
+        Tensor1D bias(layer.filters);
+        input.setRandom();
+        weights.setRandom();
+        bias.setRandom();
+
+        Conv2DOptions options;
+        options.stride_h = options.stride_w = layer.stride;
+        options.pad_h = options.pad_w = layer.pad;
+        options.activation = Activation::ReLU;
+        options.algorithm = ConvAlgorithm::Im2col;
+        Conv2D<float> lowered(weights, bias, options);
+        options.algorithm = ConvAlgorithm::Direct;
+        Conv2D<float> direct(weights, bias, options);
+
+        Tensor4D expected, output;
+        const double im2col_ms = best_time_ms([&] { expected = lowered(input); });
+        const double direct_ms = best_time_ms([&] { output = direct(input); });
+        Eigen::Tensor<float, 0, Eigen::RowMajor> scale = expected.abs().maximum();
+        Eigen::Tensor<float, 0, Eigen::RowMajor> error = (output - expected).abs().maximum();
+
+        const ConvGeometry g = lowered.geometry(input);
+        DirectConvolution<float> kernel(layer.filters, layer.channels, layer.kernel, layer.kernel);
+        const DirectGeometry dg = kernel.geometry(layer.size, layer.size, layer.stride, layer.stride, layer.pad, layer.pad);
+        std::vector<float> in_blocked(layer.batch * dg.blocks() * layer.size * layer.size * CHANNEL_BLOCK);
+        std::vector<float> out_blocked(layer.batch * channel_blocks(layer.filters) * dg.out_h() * dg.out_w() * CHANNEL_BLOCK);
+        nchw_to_blocked(input.data(), layer.batch, layer.channels, layer.size * layer.size, CHANNEL_BLOCK, in_blocked.data());
+        const double blocked_ms = best_time_ms([&] {
+            kernel.blocked(in_blocked.data(), layer.batch, dg, weights.data(), bias.data(), Activation::ReLU, out_blocked.data());
+        });
+
+        const Eigen::Index bytes = sizeof(float);
+        const Eigen::Index full_col = layer.batch * g.patch_size() * g.out_h() * g.out_w() * bytes;
+        const Eigen::Index banded_col = is_pointwise(g) ? 0 : get_num_threads() * g.patch_size() * im2col_band_rows<float>(g) * g.out_w() * bytes;
+        const bool direct_ran = direct.selected_algorithm(layer.size, layer.size) == ConvAlgorithm::Direct;
+        const Eigen::Index direct_bytes = direct_ran ? get_num_threads() * kernel.scratch_bytes() : banded_col;
+
+        std::cout << std::setw(2) << layer.batch << " x" << std::setw(4) << layer.channels << " x" << std::setw(4) << layer.size
+                  << ", K =" << std::setw(4) << layer.filters << ", " << layer.kernel << "x" << layer.kernel << "/" << layer.stride
+                  << "        " << std::fixed << std::setprecision(2) << std::setw(9) << im2col_ms << std::setw(11) << direct_ms
+                  << std::setw(12) << blocked_ms << std::scientific << std::setprecision(1) << std::setw(10) << error() / scale()
+                  << std::fixed << std::setprecision(2) << std::setw(14) << megabytes(full_col) << std::setw(15) << megabytes(banded_col)
+                  << std::setw(11) << megabytes(direct_bytes) << (direct_ran ? "" : " *") << std::defaultfloat << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv2d_layer.hpp"
+
+/*
+    im2col against FFT convolution for 5x5 and larger kernels, including wide
+    1-D filters over long signals (1 x W inputs with 1 x S kernels). Times are
+    the best of three runs; the error is max |output - reference| / max
+    |reference| against a double-precision im2col reference. The last column
+    is the path ConvAlgorithm::Auto picks from fft_conv_cost().
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+struct Layer {
+    Eigen::Index batch, channels, filters, height, width, kernel_h, kernel_w, pad;
+};
+
+double best_time_ms(const Conv2D<float> &conv, const Tensor4D &input, Tensor4D &output) {
+    double best = 1e30;
+    for (int r = 0; r < 3; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        output = conv(input);
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+int main() {
+    const std::vector<Layer> layers = {
+        {2, 8, 8, 64, 64, 5, 5, 2},
+        {4, 64, 64, 56, 56, 5, 5, 2},
+        {1, 3, 64, 224, 224, 7, 7, 3},
+        {1, 64, 64, 56, 56, 7, 7, 3},
+        {2, 16, 16, 128, 128, 11, 11, 5},
+        {1, 1, 1, 1024, 1024, 15, 15, 7},
+        {1, 4, 4, 1, 4096, 1, 63, 0},
+        {1, 1, 1, 1, 4096, 1, 255, 0}};
+
+    std::cout << "layer (N x C x H x W, K, kernel)     im2col ms (err)        FFT ms (err)   auto\n";
+    for (const Layer &layer : layers) {
+        Tensor4D input(layer.batch, layer.channels, layer.height, layer.width);
+        Tensor4D weights(layer.filters, layer.channels, layer.kernel_h, layer.kernel_w);
+        Tensor1D bias(layer.filters);
+        input.setRandom();
+        weights.setRandom();
+        bias.setRandom();
+
+        Conv2DOptions options;
+        options.pad_h = layer.kernel_h > 1 ? layer.pad : 0;
+        options.pad_w = layer.pad;
+        options.algorithm = ConvAlgorithm::Im2col;
+        Conv2D<double>::Tensor4D reference = Conv2D<double>(weights.cast<double>(), bias.cast<double>(), options)(input.cast<double>());
+        Eigen::Tensor<double, 0, Eigen::RowMajor> scale = reference.abs().maximum();
+
+        std::cout << std::setw(2) << layer.batch << " x" << std::setw(3) << layer.channels << " x" << std::setw(5) << layer.height
+                  << " x" << std::setw(5) << layer.width << ", K =" << std::setw(3) << layer.filters << ", "
+                  << std::setw(2) << layer.kernel_h << "x" << std::setw(3) << std::left << layer.kernel_w << std::right;
+
+        for (ConvAlgorithm algorithm : {ConvAlgorithm::Im2col, ConvAlgorithm::FFT}) {
+            options.algorithm = algorithm;
+            Conv2D<float> conv(weights, bias, options);
+            Tensor4D output;
+            const double ms = best_time_ms(conv, input, output);
+            Eigen::Tensor<double, 0, Eigen::RowMajor> error = (output.cast<double>() - reference).abs().maximum();
+            std::cout << std::fixed << std::setprecision(2) << std::setw(11) << ms << " ("
+                      << std::scientific << std::setprecision(1) << error() / scale() << ")" << std::defaultfloat;
+        }
+
+        options.algorithm = ConvAlgorithm::Auto;
+        Conv2D<float> automatic(weights, bias, options);
+        std::cout << "   " << (automatic.selected_algorithm(layer.height, layer.width) == ConvAlgorithm::FFT ? "FFT" : "im2col") << "\n";
+    }
+    return 0;
+}
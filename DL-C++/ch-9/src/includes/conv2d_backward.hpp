@@ -0,0 +1,148 @@
+#ifndef __MY_CONV2D_BACKWARD__
+#define __MY_CONV2D_BACKWARD__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "conv2d_layer.hpp"
+
+/*
+    Backward pass of Conv2D, on the same im2col lowering as the forward pass.
+
+    With delta = dL/d(pre-activation output), for every (image, group) and
+    band of output rows, col = im2col(input band):
+        dL/dW   += delta (Kg x band) * col^T (band x C*R*S)
+        dL/db   += row sums of delta
+        dL/dX   += col2im(W^T (C*R*S x Kg) * delta)
+    i.e. the filter gradient is a correlation of input and delta and the
+    input gradient a transposed convolution of delta.
+
+    Work is split over (image, group) pairs: each owns its slice of dL/dX, so
+    col2im never races. Each thread accumulates dL/dW and dL/db into its own
+    buffers, which are summed at the end in thread order, so for a given
+    thread count the result is bitwise reproducible.
+*/
+
+template <typename T>
+struct Conv2DGradients {
+    RowMajorTensor<T, 4> input;
+    RowMajorTensor<T, 4> weights;
+    RowMajorTensor<T, 1> bias;
+};
+
+/*
+    Gradients of a Conv2D layer for one batch. output is what the layer
+    returned for input (only read to differentiate the fused activation, so it
+    may be empty for Activation::Identity); grad_output is dL/d(output).
+    The bias gradient is empty when the layer has no bias.
+*/
+template <typename T>
+Conv2DGradients<T> conv2d_backward(const Conv2D<T> &layer, const RowMajorTensor<T, 4> &input,
+                                   const RowMajorTensor<T, 4> &output, const RowMajorTensor<T, 4> &grad_output) {
+    const ConvGeometry g = layer.geometry(input);
+    const Conv2DOptions &options = layer.settings();
+    const RowMajorTensor<T, 4> &weights = layer.filters();
+
+    const Eigen::Index N = input.dimension(0);
+    const Eigen::Index K = weights.dimension(0);
+    const Eigen::Index groups = options.groups;
+    const Eigen::Index Kg = K / groups;
+    const Eigen::Index OH = g.out_h();
+    const Eigen::Index OW = g.out_w();
+    const Eigen::Index P = OH * OW;
+    const Eigen::Index CRS = g.patch_size();
+    if (grad_output.dimension(0) != N || grad_output.dimension(1) != K || grad_output.dimension(2) != OH || grad_output.dimension(3) != OW) {
+        throw std::invalid_argument("Output gradient shape mismatch");
+    }
+    const bool activated = options.activation != Activation::Identity;
+    if (activated && output.dimensions() != grad_output.dimensions()) throw std::invalid_argument("Output shape mismatch");
+
+    RowMajorTensor<T, 4> delta = grad_output;
+    if (activated) {
+        parallel_for(N * K, [&](Eigen::Index first, Eigen::Index last) {
+            activation_backward(output.data() + first * P, delta.data() + first * P, (last - first) * P, options.activation);
+        });
+    }
+
+    Conv2DGradients<T> grads;
+    grads.input = RowMajorTensor<T, 4>(input.dimensions());
+    grads.input.setZero();
+    grads.weights = RowMajorTensor<T, 4>(weights.dimensions());
+    grads.bias = RowMajorTensor<T, 1>(layer.biases().size() != 0 ? K : 0);
+
+    // One slot per thread; slot t takes tasks [t * tasks / slots, (t + 1) * tasks / slots)
+    const Eigen::Index tasks = N * groups;
+    const Eigen::Index slots = std::min<Eigen::Index>(get_num_threads(), tasks);
+    std::vector<std::vector<T>> weight_sums(slots, std::vector<T>(weights.size(), T(0)));
+    std::vector<std::vector<T>> bias_sums(slots, std::vector<T>(K, T(0)));
+
+    const Eigen::Index band_rows = im2col_band_rows<T>(g);
+    parallel_for(slots, [&](Eigen::Index slot_begin, Eigen::Index slot_end) {
+        const bool pointwise = is_pointwise(g);
+        std::vector<T> col(pointwise ? 0 : CRS * band_rows * OW), dcol(pointwise ? 0 : CRS * band_rows * OW);
+        for (Eigen::Index slot = slot_begin; slot < slot_end; ++slot) {
+            T *dW = weight_sums[slot].data();
+            T *db = bias_sums[slot].data();
+            for (Eigen::Index task = slot * tasks / slots; task < (slot + 1) * tasks / slots; ++task) {
+                const Eigen::Index group = task % groups;
+                const Eigen::Index n = task / groups;
+                const T *image = input.data() + task * g.image_size();
+                T *dimage = grads.input.data() + task * g.image_size();
+                const T *group_delta = delta.data() + (n * K + group * Kg) * P;
+                const T *group_weights = weights.data() + group * Kg * CRS;
+                T *group_dW = dW + group * Kg * CRS;
+
+                for (Eigen::Index k = 0; k < Kg; ++k) {
+                    const T *plane = group_delta + k * P;
+                    T sum = 0;
+                    for (Eigen::Index p = 0; p < P; ++p) sum += plane[p];
+                    db[group * Kg + k] += sum;
+                }
+
+                for (Eigen::Index row_begin = 0; row_begin < OH; row_begin += band_rows) {
+                    const Eigen::Index row_end = std::min(OH, row_begin + band_rows);
+                    const Eigen::Index band = (row_end - row_begin) * OW;
+                    const T *band_delta = group_delta + row_begin * OW;
+
+                    // Pointwise layers read and write the image planes directly as col
+                    const T *band_col = image + row_begin * OW;
+                    Eigen::Index ld_col = g.height * g.width;
+                    if (!pointwise) {
+                        im2col(image, g, row_begin, row_end, col.data());
+                        band_col = col.data();
+                        ld_col = band;
+                    }
+
+                    // dW^T (C*R*S x Kg) += col^T * delta
+                    gemm<T>(true, false, CRS, Kg, band, T(1), band_col, ld_col, band_delta, P, T(1), group_dW, CRS);
+
+                    // dcol (band x C*R*S) = delta * W
+                    if (pointwise) {
+                        gemm<T>(false, true, band, CRS, Kg, T(1), band_delta, P, group_weights, CRS, T(0), dimage + row_begin * OW, ld_col);
+                    } else {
+                        gemm<T>(false, true, band, CRS, Kg, T(1), band_delta, P, group_weights, CRS, T(0), dcol.data(), band);
+                        col2im(dcol.data(), g, row_begin, row_end, dimage);
+                    }
+                }
+            }
+        }
+    }, static_cast<int>(slots));
+
+    // Fixed-order reduction of the per-thread sums
+    parallel_for(weights.size(), [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index i = first; i < last; ++i) {
+            T sum = weight_sums[0][i];
+            for (Eigen::Index slot = 1; slot < slots; ++slot) sum += weight_sums[slot][i];
+            grads.weights.data()[i] = sum;
+        }
+    });
+    for (Eigen::Index k = 0; k < grads.bias.size(); ++k) {
+        T sum = bias_sums[0][k];
+        for (Eigen::Index slot = 1; slot < slots; ++slot) sum += bias_sums[slot][k];
+        grads.bias(k) = sum;
+    }
+    return grads;
+}
+
+#endif
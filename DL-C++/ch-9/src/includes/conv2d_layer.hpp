@@ -0,0 +1,231 @@
+#ifndef __MY_CONV2D_LAYER__
+#define __MY_CONV2D_LAYER__
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "direct_conv.hpp"
+#include "epilogue.hpp"
+#include "fft_conv.hpp"
+#include "im2col.hpp"
+#include "parallel.hpp"
+#include "winograd.hpp"
+
+/*
+    Batched multi-channel 2-D convolution layer.
+
+    Tensors are row-major so that dimension order is memory order:
+        input   : N x C x H x W           (NCHW)
+        weights : K x C/groups x R x S
+        bias    : K (or empty)
+        output  : N x K x OH x OW
+
+    Each (image, group) pair is lowered with im2col and multiplied by the
+    group's filters on the shared GEMM. The work is split into bands of output
+    rows, every band producing all output channels of its group, so threads
+    never redo each other's im2col and never write the same output element.
+    Bias and activation are applied to each band right after its GEMM, while
+    it is still in cache.
+
+    Stride-1, undilated 3x3 layers run on Winograd F(4x4, 3x3) instead when
+    they have enough channels for the transforms to pay off (see winograd.hpp
+    for the error budget). Stride-1, undilated layers with kernels of at least
+    FFT_MIN_KERNEL on a side choose per input size between im2col and FFT
+    convolution (fft_conv.hpp) with the cost model in fft_conv_cost().
+    ConvAlgorithm overrides the choice; ConvAlgorithm::Direct (ungrouped
+    layers only) runs the register-tiled kernel of direct_conv.hpp straight
+    on NCHW, which needs no patch buffer at all (pointwise layers, which have
+    none to save, stay on the GEMM).
+*/
+
+template <typename T, int Rank>
+using RowMajorTensor = Eigen::Tensor<T, Rank, Eigen::RowMajor>;
+
+enum class ConvAlgorithm { Auto, Im2col, Winograd2x2, Winograd4x4, FFT, Direct };
+
+// Auto uses Winograd only when both the input and output channels per group
+// reach this; below it the transforms cost more than the saved multiplies
+// (measured crossover between 32 and 64 channels)
+constexpr Eigen::Index WINOGRAD_MIN_CHANNELS = 64;
+
+// Smallest kernel side for which Auto considers the FFT path
+constexpr Eigen::Index FFT_MIN_KERNEL = 5;
+
+struct Conv2DOptions {
+    Eigen::Index stride_h = 1;
+    Eigen::Index stride_w = 1;
+    Eigen::Index pad_h = 0;
+    Eigen::Index pad_w = 0;
+    Eigen::Index dilation_h = 1;
+    Eigen::Index dilation_w = 1;
+    Eigen::Index groups = 1;
+    Activation activation = Activation::Identity;
+    ConvAlgorithm algorithm = ConvAlgorithm::Auto;
+};
+
+template <typename T>
+class Conv2D {
+public:
+    static constexpr Layout preferred_layout = Layout::NCHW;
+
+    using Tensor4D = RowMajorTensor<T, 4>;
+    using Tensor1D = RowMajorTensor<T, 1>;
+
+    Conv2D(Tensor4D weights_, Tensor1D bias_, Conv2DOptions options_ = Conv2DOptions())
+        : weights(std::move(weights_)), bias(std::move(bias_)), options(options_) {
+        if (options.groups < 1 || weights.dimension(0) % options.groups != 0) throw std::invalid_argument("Filter count not divisible by groups");
+        if (bias.size() != 0 && bias.dimension(0) != weights.dimension(0)) throw std::invalid_argument("Bias size mismatch");
+        if (options.stride_h < 1 || options.stride_w < 1 || options.dilation_h < 1 || options.dilation_w < 1) throw std::invalid_argument("Stride and dilation must be positive");
+        if (options.pad_h < 0 || options.pad_w < 0) throw std::invalid_argument("Negative padding");
+        algorithm = select_algorithm();
+
+        const Eigen::Index K = weights.dimension(0);
+        const Eigen::Index Cg = weights.dimension(1);
+        if (algorithm == ConvAlgorithm::Winograd2x2) winograd2 = std::make_shared<const WinogradConvolution<T, 2>>(weights.data(), K, Cg, options.groups);
+        if (algorithm == ConvAlgorithm::Winograd4x4) winograd4 = std::make_shared<const WinogradConvolution<T, 4>>(weights.data(), K, Cg, options.groups);
+        if (algorithm == ConvAlgorithm::FFT || algorithm == ConvAlgorithm::Auto) {
+            fft = std::make_shared<const FFTConvolution<T>>(weights.data(), K, Cg, options.groups, weights.dimension(2), weights.dimension(3));
+        }
+    }
+
+    // Per-group geometry of an N x C x H x W input
+    ConvGeometry geometry(const Tensor4D &input) const {
+        if (input.dimension(1) != weights.dimension(1) * options.groups) throw std::invalid_argument("Input channel mismatch");
+
+        ConvGeometry g;
+        g.channels = weights.dimension(1);
+        g.height = input.dimension(2);
+        g.width = input.dimension(3);
+        g.kernel_h = weights.dimension(2);
+        g.kernel_w = weights.dimension(3);
+        g.stride_h = options.stride_h;
+        g.stride_w = options.stride_w;
+        g.pad_h = options.pad_h;
+        g.pad_w = options.pad_w;
+        g.dilation_h = options.dilation_h;
+        g.dilation_w = options.dilation_w;
+        if (g.out_h() <= 0 || g.out_w() <= 0) throw std::invalid_argument("Kernel larger than padded input");
+        return g;
+    }
+
+    Tensor4D operator()(const Tensor4D &input) const {
+        const ConvGeometry g = geometry(input);
+        const Eigen::Index N = input.dimension(0);
+        const ConvAlgorithm selected = selected_algorithm(g.height, g.width);
+        if (selected != ConvAlgorithm::Im2col) {
+            Tensor4D output(N, weights.dimension(0), g.out_h(), g.out_w());
+            const T *bias_data = bias.size() != 0 ? bias.data() : nullptr;
+            const T *in = input.data();
+            T *out = output.data();
+            if (selected == ConvAlgorithm::Winograd2x2) (*winograd2)(in, N, g.height, g.width, g.pad_h, g.pad_w, bias_data, options.activation, out);
+            if (selected == ConvAlgorithm::Winograd4x4) (*winograd4)(in, N, g.height, g.width, g.pad_h, g.pad_w, bias_data, options.activation, out);
+            if (selected == ConvAlgorithm::FFT) (*fft)(in, N, g.height, g.width, g.pad_h, g.pad_w, bias_data, options.activation, out);
+            if (selected == ConvAlgorithm::Direct) {
+                const DirectConvolution<T> direct(weights.dimension(0), weights.dimension(1), weights.dimension(2), weights.dimension(3));
+                direct(in, N, direct.geometry(g.height, g.width, g.stride_h, g.stride_w, g.pad_h, g.pad_w, g.dilation_h, g.dilation_w),
+                       weights.data(), bias_data, options.activation, out);
+            }
+            return output;
+        }
+
+        const Eigen::Index K = weights.dimension(0);
+        const Eigen::Index groups = options.groups;
+        const Eigen::Index group_filters = K / groups;
+        const Eigen::Index OH = g.out_h();
+        const Eigen::Index OW = g.out_w();
+        const Eigen::Index P = OH * OW;
+        const Eigen::Index CRS = g.patch_size();
+
+        const Eigen::Index band_rows = im2col_band_rows<T>(g);
+        const Eigen::Index bands = (OH + band_rows - 1) / band_rows;
+
+        Tensor4D output(N, K, OH, OW);
+        const T *in = input.data();
+        T *out = output.data();
+
+        parallel_for(N * groups * bands, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> col(is_pointwise(g) ? 0 : CRS * band_rows * OW);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index band = task % bands;
+                const Eigen::Index group = (task / bands) % groups;
+                const Eigen::Index n = task / (bands * groups);
+                const Eigen::Index row_begin = band * band_rows;
+                const Eigen::Index row_end = std::min(OH, row_begin + band_rows);
+
+                const T *image = in + (n * groups + group) * g.image_size();
+                T *group_out = out + (n * K + group * group_filters) * P;
+                conv2d_im2col_rows(image, g, weights.data() + group * group_filters * CRS, group_filters,
+                                   group_out, col.data(), row_begin, row_end);
+                epilogue(group_out, group * group_filters, group_filters, P, row_begin * OW, row_end * OW);
+            }
+        });
+        return output;
+    }
+
+    Eigen::Index size() const { return weights.size() + bias.size(); }
+
+    const Tensor4D &filters() const { return weights; }
+    const Tensor1D &biases() const { return bias; }
+    const Conv2DOptions &settings() const { return options; }
+
+    // The algorithm used for height x width inputs, Auto resolved
+    ConvAlgorithm selected_algorithm(Eigen::Index height, Eigen::Index width) const {
+        if (algorithm != ConvAlgorithm::Auto) return algorithm;
+        const Eigen::Index Kg = weights.dimension(0) / options.groups;
+        const double direct = im2col_conv_cost(height, width, options.pad_h, options.pad_w,
+                                               weights.dimension(2), weights.dimension(3), weights.dimension(1), Kg);
+        const double spectral = fft_conv_cost(height, width, options.pad_h, options.pad_w,
+                                              weights.dimension(2), weights.dimension(3), weights.dimension(1), Kg);
+        return spectral < direct ? ConvAlgorithm::FFT : ConvAlgorithm::Im2col;
+    }
+
+private:
+    // Resolves everything that does not depend on the input size; Auto is
+    // kept only for layers whose choice between im2col and FFT does
+    ConvAlgorithm select_algorithm() const {
+        const Eigen::Index R = weights.dimension(2);
+        const Eigen::Index S = weights.dimension(3);
+        const bool unit_stride = options.stride_h == 1 && options.stride_w == 1 &&
+                                 options.dilation_h == 1 && options.dilation_w == 1;
+        const bool winograd_shape = unit_stride && R == 3 && S == 3;
+
+        if (options.algorithm == ConvAlgorithm::Auto) {
+            const bool enough_channels = weights.dimension(1) >= WINOGRAD_MIN_CHANNELS &&
+                                         weights.dimension(0) / options.groups >= WINOGRAD_MIN_CHANNELS;
+            if (winograd_shape && enough_channels) return ConvAlgorithm::Winograd4x4;
+            if (unit_stride && std::max(R, S) >= FFT_MIN_KERNEL) return ConvAlgorithm::Auto;
+            return ConvAlgorithm::Im2col;
+        }
+        if ((options.algorithm == ConvAlgorithm::Winograd2x2 || options.algorithm == ConvAlgorithm::Winograd4x4) && !winograd_shape) {
+            throw std::invalid_argument("Winograd needs a stride-1, undilated 3x3 convolution");
+        }
+        if (options.algorithm == ConvAlgorithm::FFT && !unit_stride) throw std::invalid_argument("FFT convolution needs stride 1 and no dilation");
+        if (options.algorithm == ConvAlgorithm::Direct && options.groups != 1) throw std::invalid_argument("Direct convolution needs groups == 1");
+        // A pointwise layer has no patches: its im2col path is already a plain GEMM without scratch
+        const bool pointwise = R == 1 && S == 1 && options.stride_h == 1 && options.stride_w == 1 && options.pad_h == 0 && options.pad_w == 0;
+        if (options.algorithm == ConvAlgorithm::Direct && pointwise) return ConvAlgorithm::Im2col;
+        return options.algorithm;
+    }
+
+    // Bias + activation on positions [begin, end) of out_channels output planes
+    void epilogue(T *out, Eigen::Index first_channel, Eigen::Index out_channels, Eigen::Index P,
+                  Eigen::Index begin, Eigen::Index end) const {
+        for (Eigen::Index k = 0; k < out_channels; ++k) {
+            const bool has_bias = bias.size() != 0;
+            bias_activation(out + k * P + begin, end - begin, has_bias, has_bias ? bias(first_channel + k) : T(0), options.activation);
+        }
+    }
+
+    Tensor4D weights;
+    Tensor1D bias;
+    Conv2DOptions options;
+    ConvAlgorithm algorithm;
+    std::shared_ptr<const WinogradConvolution<T, 2>> winograd2;
+    std::shared_ptr<const WinogradConvolution<T, 4>> winograd4;
+    std::shared_ptr<const FFTConvolution<T>> fft;
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef __MY_CONV_POOL__
+#define __MY_CONV_POOL__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "conv2d_layer.hpp"
+
+/*
+    Conv2D -> bias -> activation -> max-pool as one pass.
+
+    The unfused stage writes the full N x K x OH x OW convolution output and
+    reads it back to pool it. Here each task computes one band of conv
+    output rows for one (image, group) with im2col + GEMM into a per-thread
+    buffer sized to stay in L2, applies bias and activation there and pools
+    it straight away; only the pooled N x K x PH x PW tensor is written.
+    For the usual 2x2/2 pool that cuts the stage's output traffic to a
+    quarter, and the conv output's write-back and re-read go away.
+
+    Pooling is "valid" (no padding): PH = (OH - pool_h) / pool_stride_h + 1.
+    When windows overlap (stride < size), the conv rows shared by two bands
+    are computed by both.
+
+    Only the im2col path works band by band. When the wrapped Conv2D selects
+    Winograd, FFT or direct convolution, which transform whole images, the
+    block runs that path and pools its output in a second pass, so it is
+    never slower than the layer it wraps.
+*/
+
+struct MaxPoolOptions {
+    Eigen::Index size_h = 2;
+    Eigen::Index size_w = 2;
+    Eigen::Index stride_h = 2;
+    Eigen::Index stride_w = 2;
+};
+
+// One pooled row: max over the size_h rows of width W starting at top, then
+// over each window's columns. window_max holds W values.
+template <typename T>
+void max_pool_row(const T *top, Eigen::Index W, const MaxPoolOptions &pool, Eigen::Index PW, T *window_max, T *out) {
+    std::copy(top, top + W, window_max);
+    for (Eigen::Index i = 1; i < pool.size_h; ++i) {
+        const T *row = top + i * W;
+        for (Eigen::Index w = 0; w < W; ++w) window_max[w] = std::max(window_max[w], row[w]);
+    }
+    for (Eigen::Index pw = 0; pw < PW; ++pw) {
+        const T *window = window_max + pw * pool.stride_w;
+        out[pw] = *std::max_element(window, window + pool.size_w);
+    }
+}
+
+// Valid max-pool of `planes` row-major H x W planes into PH x PW planes
+template <typename T>
+void max_pool_planes(const T *input, Eigen::Index planes, Eigen::Index H, Eigen::Index W, const MaxPoolOptions &pool, T *output) {
+    const Eigen::Index PH = (H - pool.size_h) / pool.stride_h + 1, PW = (W - pool.size_w) / pool.stride_w + 1;
+    parallel_for(planes, [&](Eigen::Index first, Eigen::Index last) {
+        std::vector<T> window_max(W);
+        for (Eigen::Index plane = first; plane < last; ++plane) {
+            for (Eigen::Index ph = 0; ph < PH; ++ph) {
+                max_pool_row(input + (plane * H + ph * pool.stride_h) * W, W, pool, PW, window_max.data(), output + (plane * PH + ph) * PW);
+            }
+        }
+    });
+}
+
+template <typename T>
+class Conv2DMaxPool {
+public:
+    static constexpr Layout preferred_layout = Layout::NCHW;
+
+    using Tensor4D = RowMajorTensor<T, 4>;
+    using Tensor1D = RowMajorTensor<T, 1>;
+
+    Conv2DMaxPool(Tensor4D weights, Tensor1D bias, Conv2DOptions conv_options = Conv2DOptions(),
+                  MaxPoolOptions pool_options = MaxPoolOptions())
+        : conv(std::move(weights), std::move(bias), conv_options), pool(pool_options) {
+        if (pool.size_h < 1 || pool.size_w < 1 || pool.stride_h < 1 || pool.stride_w < 1) {
+            throw std::invalid_argument("Pool size and stride must be positive");
+        }
+    }
+
+    Tensor4D operator()(const Tensor4D &input) const {
+        const ConvGeometry g = conv.geometry(input);
+        const Conv2DOptions &options = conv.settings();
+        const Tensor4D &weights = conv.filters();
+        const Tensor1D &bias = conv.biases();
+
+        const Eigen::Index N = input.dimension(0);
+        const Eigen::Index K = weights.dimension(0);
+        const Eigen::Index groups = options.groups;
+        const Eigen::Index Kg = K / groups;
+        const Eigen::Index OW = g.out_w();
+        const Eigen::Index PH = pooled(g.out_h(), pool.size_h, pool.stride_h);
+        const Eigen::Index PW = pooled(OW, pool.size_w, pool.stride_w);
+        const Eigen::Index CRS = g.patch_size();
+
+        if (conv.selected_algorithm(g.height, g.width) != ConvAlgorithm::Im2col) {
+            const Tensor4D activations = conv(input);
+            Tensor4D output(N, K, PH, PW);
+            max_pool_planes(activations.data(), N * K, g.out_h(), OW, pool, output.data());
+            return output;
+        }
+
+        // Pooled rows per band, so that the band's conv rows fit the im2col band
+        const Eigen::Index band_rows = im2col_band_rows<T>(g);
+        const Eigen::Index pooled_rows = std::clamp<Eigen::Index>((band_rows - pool.size_h) / pool.stride_h + 1, 1, PH);
+        const Eigen::Index conv_rows = (pooled_rows - 1) * pool.stride_h + pool.size_h;
+        const Eigen::Index bands = (PH + pooled_rows - 1) / pooled_rows;
+
+        Tensor4D output(N, K, PH, PW);
+        parallel_for(N * groups * bands, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> col(CRS * conv_rows * OW), rows(Kg * conv_rows * OW), window_max(OW);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index band = task % bands;
+                const Eigen::Index group = (task / bands) % groups;
+                const Eigen::Index n = task / (bands * groups);
+                const Eigen::Index ph_begin = band * pooled_rows;
+                const Eigen::Index ph_end = std::min(PH, ph_begin + pooled_rows);
+                const Eigen::Index row_begin = ph_begin * pool.stride_h;
+                const Eigen::Index row_end = (ph_end - 1) * pool.stride_h + pool.size_h;
+                const Eigen::Index count = (row_end - row_begin) * OW;
+
+                // rows (Kg x count, row-major) = this band of the group's conv output
+                const T *image = input.data() + (n * groups + group) * g.image_size();
+                im2col(image, g, row_begin, row_end, col.data());
+                gemm<T>(false, false, count, Kg, CRS, T(1), col.data(), count, weights.data() + group * Kg * CRS, CRS,
+                        T(0), rows.data(), count);
+
+                for (Eigen::Index k = 0; k < Kg; ++k) {
+                    const Eigen::Index channel = group * Kg + k;
+                    T *plane = rows.data() + k * count;
+                    bias_activation(plane, count, bias.size() != 0, bias.size() != 0 ? bias(channel) : T(0), options.activation);
+
+                    T *out = output.data() + ((n * K + channel) * PH + ph_begin) * PW;
+                    for (Eigen::Index ph = ph_begin; ph < ph_end; ++ph, out += PW) {
+                        max_pool_row(plane + (ph * pool.stride_h - row_begin) * OW, OW, pool, PW, window_max.data(), out);
+                    }
+                }
+            }
+        });
+        return output;
+    }
+
+    const Conv2D<T> &convolution() const { return conv; }
+    const MaxPoolOptions &pooling() const { return pool; }
+
+private:
+    static Eigen::Index pooled(Eigen::Index size, Eigen::Index window, Eigen::Index stride) {
+        if (size < window) throw std::invalid_argument("Pool window larger than convolution output");
+        return (size - window) / stride + 1;
+    }
+
+    Conv2D<T> conv;
+    MaxPoolOptions pool;
+};
+
+#endif
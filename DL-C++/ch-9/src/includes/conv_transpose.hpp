@@ -0,0 +1,161 @@
+#ifndef __MY_CONV_TRANSPOSE__
+#define __MY_CONV_TRANSPOSE__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "conv2d_layer.hpp"
+
+/*
+    Transposed ("fractionally strided") 2-D convolution, the learned
+    upsampling of decoders and segmentation heads.
+
+    Tensors are row-major:
+        input   : N x C x H x W
+        weights : C x K/groups x R x S     (input channels first, as in PyTorch)
+        bias    : K (or empty)
+        output  : N x K x OH x OW,  OH = (H - 1) * stride_h - 2 * pad_h
+                                         + dilation_h * (R - 1) + output_pad_h + 1
+
+    It is the adjoint of Conv2D with the same geometry: every input pixel
+    scatters its C-vector times the filters onto an R x S output window. Per
+    (image, group) that is one GEMM
+        col (K/groups*R*S x H*W) = W^T (K/groups*R*S x C/groups) * X (C/groups x H*W)
+    followed by col2im() onto the output, so no multiplications by the zeros
+    a dilate-then-convolve formulation inserts are done. The input is
+    processed in bands of rows so col stays in L2.
+
+    Tasks are (image, group, block of output channels): each owns a disjoint
+    slice of the output, so col2im needs no synchronisation, and a single
+    image is still spread over all threads.
+*/
+
+struct ConvTranspose2DOptions {
+    Eigen::Index stride_h = 1;
+    Eigen::Index stride_w = 1;
+    Eigen::Index pad_h = 0;
+    Eigen::Index pad_w = 0;
+    Eigen::Index output_pad_h = 0;
+    Eigen::Index output_pad_w = 0;
+    Eigen::Index dilation_h = 1;
+    Eigen::Index dilation_w = 1;
+    Eigen::Index groups = 1;
+    Activation activation = Activation::Identity;
+};
+
+template <typename T>
+class ConvTranspose2D {
+public:
+    static constexpr Layout preferred_layout = Layout::NCHW;
+
+    using Tensor4D = RowMajorTensor<T, 4>;
+    using Tensor1D = RowMajorTensor<T, 1>;
+
+    ConvTranspose2D(Tensor4D weights_, Tensor1D bias_, ConvTranspose2DOptions options_ = ConvTranspose2DOptions())
+        : weights(std::move(weights_)), bias(std::move(bias_)), options(options_) {
+        if (options.groups < 1 || weights.dimension(0) % options.groups != 0) throw std::invalid_argument("Channel count not divisible by groups");
+        if (bias.size() != 0 && bias.dimension(0) != filters()) throw std::invalid_argument("Bias size mismatch");
+        if (options.stride_h < 1 || options.stride_w < 1 || options.dilation_h < 1 || options.dilation_w < 1) throw std::invalid_argument("Stride and dilation must be positive");
+        if (options.pad_h < 0 || options.pad_w < 0) throw std::invalid_argument("Negative padding");
+        // Only the last stride - 1 rows/columns are ambiguous in size; more would be all bias
+        if (options.output_pad_h < 0 || options.output_pad_w < 0 ||
+            options.output_pad_h >= options.stride_h || options.output_pad_w >= options.stride_w) {
+            throw std::invalid_argument("Output padding must be smaller than the stride");
+        }
+    }
+
+    Eigen::Index filters() const { return weights.dimension(1) * options.groups; }
+
+    /*
+        Geometry of the convolution this layer transposes, per group: its
+        input is one group of our output and its output our input, so
+        col2im() with it scatters onto our output.
+    */
+    ConvGeometry geometry(const Tensor4D &input) const {
+        if (input.dimension(1) != weights.dimension(0)) throw std::invalid_argument("Input channel mismatch");
+
+        ConvGeometry g;
+        g.channels = weights.dimension(1);
+        g.kernel_h = weights.dimension(2);
+        g.kernel_w = weights.dimension(3);
+        g.height = (input.dimension(2) - 1) * options.stride_h - 2 * options.pad_h + options.dilation_h * (g.kernel_h - 1) + options.output_pad_h + 1;
+        g.width = (input.dimension(3) - 1) * options.stride_w - 2 * options.pad_w + options.dilation_w * (g.kernel_w - 1) + options.output_pad_w + 1;
+        g.stride_h = options.stride_h;
+        g.stride_w = options.stride_w;
+        g.pad_h = options.pad_h;
+        g.pad_w = options.pad_w;
+        g.dilation_h = options.dilation_h;
+        g.dilation_w = options.dilation_w;
+        if (g.height <= 0 || g.width <= 0) throw std::invalid_argument("Padding larger than output");
+        return g;
+    }
+
+    Tensor4D operator()(const Tensor4D &input) const {
+        const ConvGeometry g = geometry(input);
+        const Eigen::Index N = input.dimension(0);
+        const Eigen::Index H = input.dimension(2);
+        const Eigen::Index W = input.dimension(3);
+        const Eigen::Index groups = options.groups;
+        const Eigen::Index Cg = weights.dimension(0) / groups;
+        const Eigen::Index Kg = weights.dimension(1);
+        const Eigen::Index K = Kg * groups;
+        const Eigen::Index RS = g.kernel_h * g.kernel_w;
+        const Eigen::Index out_plane = g.height * g.width;
+
+        // Output channel blocks per (image, group): enough tasks for every thread
+        const Eigen::Index images = N * groups;
+        const Eigen::Index blocks = std::min(Kg, (get_num_threads() + images - 1) / images);
+        const Eigen::Index band_rows = im2col_band_rows<T>(g);
+
+        Tensor4D output(N, K, g.height, g.width);
+        output.setZero();
+        parallel_for(images * blocks, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> col(((Kg + blocks - 1) / blocks) * RS * band_rows * W);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index block = task % blocks;
+                const Eigen::Index group = (task / blocks) % groups;
+                const Eigen::Index n = task / (blocks * groups);
+                const Eigen::Index k_begin = block * Kg / blocks;
+                const Eigen::Index k_end = (block + 1) * Kg / blocks;
+
+                ConvGeometry block_g = g;
+                block_g.channels = k_end - k_begin;
+                const Eigen::Index block_rows = block_g.patch_size();
+
+                const T *image = input.data() + (n * groups + group) * Cg * H * W;
+                const T *group_weights = weights.data() + group * Cg * Kg * RS + k_begin * RS;
+                T *out = output.data() + (n * K + group * Kg + k_begin) * out_plane;
+
+                for (Eigen::Index row_begin = 0; row_begin < H; row_begin += band_rows) {
+                    const Eigen::Index row_end = std::min(H, row_begin + band_rows);
+                    const Eigen::Index band = (row_end - row_begin) * W;
+                    // col (band x block_rows, column-major) = X^T (band x Cg) * W (Cg x block_rows)
+                    gemm<T>(false, true, band, block_rows, Cg, T(1), image + row_begin * W, H * W,
+                            group_weights, Kg * RS, T(0), col.data(), band);
+                    col2im(col.data(), block_g, row_begin, row_end, out);
+                }
+
+                for (Eigen::Index k = k_begin; k < k_end; ++k) {
+                    const bool has_bias = bias.size() != 0;
+                    bias_activation(out + (k - k_begin) * out_plane, out_plane, has_bias,
+                                    has_bias ? bias(group * Kg + k) : T(0), options.activation);
+                }
+            }
+        });
+        return output;
+    }
+
+    Eigen::Index size() const { return weights.size() + bias.size(); }
+
+    const Tensor4D &kernels() const { return weights; }
+    const Tensor1D &biases() const { return bias; }
+    const ConvTranspose2DOptions &settings() const { return options; }
+
+private:
+    Tensor4D weights;
+    Tensor1D bias;
+    ConvTranspose2DOptions options;
+};
+
+#endif
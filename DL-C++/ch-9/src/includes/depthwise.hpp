@@ -0,0 +1,253 @@
+#ifndef __MY_DEPTHWISE__
+#define __MY_DEPTHWISE__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "epilogue.hpp"
+#include "gemm.hpp"
+#include "layout.hpp"
+#include "parallel.hpp"
+
+/*
+    Depthwise and depthwise-separable convolution in NHWC layout.
+
+    A depthwise convolution filters every channel with its own R x S kernel,
+    so there is no reduction over channels and nothing for a GEMM to block
+    on: through im2col it is C tiny matrix-vector products that spend their
+    time in the unrolling. In NHWC the channels of one pixel are contiguous,
+    so each filter tap is a single length-C vector multiply-add
+        out[oh][ow][:] += in[ih][iw][:] * w[r][s][:]
+    which the compiler vectorizes across channels. 3x3 and 5x5 kernels are
+    compiled with a fixed kernel width for cheaper tap addressing.
+
+        input     : N x H x W x C       (NHWC)
+        depthwise : R x S x C            bias C (or empty)
+        pointwise : K x C                bias K (or empty)
+        output    : N x OH x OW x C or N x OH x OW x K
+
+    DepthwiseSeparableConv2D fuses depthwise -> pointwise: it computes a band
+    of depthwise output rows into a per-thread buffer sized to stay in L2 and
+    immediately multiplies it by the pointwise filters, so the C-channel
+    intermediate never travels to memory.
+*/
+
+struct DepthwiseOptions {
+    Eigen::Index stride_h = 1;
+    Eigen::Index stride_w = 1;
+    Eigen::Index pad_h = 0;
+    Eigen::Index pad_w = 0;
+    Activation activation = Activation::Identity;
+};
+
+// Bytes of depthwise output kept per band in the fused block
+constexpr Eigen::Index DEPTHWISE_BAND_BYTES = 256 * 1024;
+
+// Channels accumulated together in registers across all taps of a pixel
+constexpr Eigen::Index DEPTHWISE_CHANNEL_BLOCK = 16;
+
+// acc[0, n) += sum over the valid taps of in[:] * w[:] for one output pixel; KW > 0 fixes the weight row stride
+template <typename T, int KW, int N>
+inline void depthwise_pixel(const T *image, Eigen::Index W, Eigen::Index C, const T *weights, Eigen::Index S,
+                            Eigen::Index ih0, Eigen::Index iw0, Eigen::Index r_begin, Eigen::Index r_end,
+                            Eigen::Index s_begin, Eigen::Index s_end, Eigen::Index n, T *acc) {
+    const Eigen::Index count = N > 0 ? N : n;
+    for (Eigen::Index r = r_begin; r < r_end; ++r) {
+        for (Eigen::Index s = s_begin; s < s_end; ++s) {
+            const T *in = image + ((ih0 + r) * W + iw0 + s) * C;
+            const T *w = weights + (r * (KW > 0 ? KW : S) + s) * C;
+            for (Eigen::Index c = 0; c < count; ++c) acc[c] += in[c] * w[c];
+        }
+    }
+}
+
+/*
+    Output rows [row_begin, row_end) of one H x W x C image into out, a
+    (row_end - row_begin) x OW x C buffer. KH/KW > 0 fix the kernel size at
+    compile time; 0 takes it from R/S.
+
+    Each pixel is done DEPTHWISE_CHANNEL_BLOCK channels at a time with the
+    accumulators held in registers over every tap, so a tap costs one load of
+    input and weight per multiply-add and the output is stored once.
+*/
+template <typename T, int KH, int KW>
+void depthwise_nhwc_rows(const T *image, Eigen::Index H, Eigen::Index W, Eigen::Index C,
+                         const T *weights, Eigen::Index R_, Eigen::Index S_, const T *bias,
+                         const DepthwiseOptions &o, Eigen::Index OW, Eigen::Index row_begin, Eigen::Index row_end, T *out) {
+    constexpr Eigen::Index CB = DEPTHWISE_CHANNEL_BLOCK;
+    const Eigen::Index R = KH > 0 ? KH : R_;
+    const Eigen::Index S = KW > 0 ? KW : S_;
+
+    for (Eigen::Index oh = row_begin; oh < row_end; ++oh) {
+        const Eigen::Index ih0 = oh * o.stride_h - o.pad_h;
+        const Eigen::Index r_begin = std::max<Eigen::Index>(0, -ih0);
+        const Eigen::Index r_end = std::min<Eigen::Index>(R, H - ih0);
+        T *row = out + (oh - row_begin) * OW * C;
+
+        for (Eigen::Index ow = 0; ow < OW; ++ow) {
+            const Eigen::Index iw0 = ow * o.stride_w - o.pad_w;
+            const Eigen::Index s_begin = std::max<Eigen::Index>(0, -iw0);
+            const Eigen::Index s_end = std::min<Eigen::Index>(S, W - iw0);
+            T *dst = row + ow * C;
+
+            Eigen::Index c0 = 0;
+            for (; c0 + CB <= C; c0 += CB) {
+                T acc[CB];
+                for (Eigen::Index c = 0; c < CB; ++c) acc[c] = bias ? bias[c0 + c] : T(0);
+                depthwise_pixel<T, KW, CB>(image + c0, W, C, weights + c0, S, ih0, iw0, r_begin, r_end, s_begin, s_end, CB, acc);
+                std::copy(acc, acc + CB, dst + c0);
+            }
+            if (c0 < C) {
+                T acc[CB];
+                const Eigen::Index n = C - c0;
+                for (Eigen::Index c = 0; c < n; ++c) acc[c] = bias ? bias[c0 + c] : T(0);
+                depthwise_pixel<T, KW, 0>(image + c0, W, C, weights + c0, S, ih0, iw0, r_begin, r_end, s_begin, s_end, n, acc);
+                std::copy(acc, acc + n, dst + c0);
+            }
+        }
+        apply_activation(row, OW * C, o.activation);
+    }
+}
+
+template <typename T>
+void depthwise_nhwc(const T *image, Eigen::Index H, Eigen::Index W, Eigen::Index C,
+                    const T *weights, Eigen::Index R, Eigen::Index S, const T *bias,
+                    const DepthwiseOptions &o, Eigen::Index OW, Eigen::Index row_begin, Eigen::Index row_end, T *out) {
+    if (R == 3 && S == 3) {
+        depthwise_nhwc_rows<T, 3, 3>(image, H, W, C, weights, R, S, bias, o, OW, row_begin, row_end, out);
+    } else if (R == 5 && S == 5) {
+        depthwise_nhwc_rows<T, 5, 5>(image, H, W, C, weights, R, S, bias, o, OW, row_begin, row_end, out);
+    } else {
+        depthwise_nhwc_rows<T, 0, 0>(image, H, W, C, weights, R, S, bias, o, OW, row_begin, row_end, out);
+    }
+}
+
+template <typename T>
+class DepthwiseConv2D {
+public:
+    static constexpr Layout preferred_layout = Layout::NHWC;
+
+    using Tensor4D = Eigen::Tensor<T, 4, Eigen::RowMajor>;
+    using Tensor3D = Eigen::Tensor<T, 3, Eigen::RowMajor>;
+    using Tensor1D = Eigen::Tensor<T, 1, Eigen::RowMajor>;
+
+    // weights: R x S x C
+    DepthwiseConv2D(Tensor3D weights_, Tensor1D bias_, DepthwiseOptions options_ = DepthwiseOptions())
+        : weights(std::move(weights_)), bias(std::move(bias_)), options(options_) {
+        if (bias.size() != 0 && bias.dimension(0) != weights.dimension(2)) throw std::invalid_argument("Bias size mismatch");
+        if (options.stride_h < 1 || options.stride_w < 1) throw std::invalid_argument("Stride must be positive");
+        if (options.pad_h < 0 || options.pad_w < 0) throw std::invalid_argument("Negative padding");
+    }
+
+    Eigen::Index out_h(Eigen::Index H) const { return (H + 2 * options.pad_h - weights.dimension(0)) / options.stride_h + 1; }
+    Eigen::Index out_w(Eigen::Index W) const { return (W + 2 * options.pad_w - weights.dimension(1)) / options.stride_w + 1; }
+    Eigen::Index channels() const { return weights.dimension(2); }
+
+    void check_input(const Tensor4D &input) const {
+        if (input.dimension(3) != channels()) throw std::invalid_argument("Input channel mismatch");
+        if (out_h(input.dimension(1)) <= 0 || out_w(input.dimension(2)) <= 0) throw std::invalid_argument("Kernel larger than padded input");
+    }
+
+    // Output rows [row_begin, row_end) of image n into a rows x OW x C buffer
+    void rows(const Tensor4D &input, Eigen::Index n, Eigen::Index row_begin, Eigen::Index row_end, T *out) const {
+        const Eigen::Index H = input.dimension(1), W = input.dimension(2), C = channels();
+        depthwise_nhwc(input.data() + n * H * W * C, H, W, C, weights.data(), weights.dimension(0), weights.dimension(1),
+                       bias.size() != 0 ? bias.data() : nullptr, options, out_w(W), row_begin, row_end, out);
+    }
+
+    Tensor4D operator()(const Tensor4D &input) const {
+        check_input(input);
+        const Eigen::Index N = input.dimension(0);
+        const Eigen::Index OH = out_h(input.dimension(1));
+        const Eigen::Index OW = out_w(input.dimension(2));
+        const Eigen::Index C = channels();
+
+        Tensor4D output(N, OH, OW, C);
+        parallel_for(N * OH, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index n = task / OH;
+                const Eigen::Index oh = task % OH;
+                rows(input, n, oh, oh + 1, output.data() + ((n * OH + oh) * OW) * C);
+            }
+        });
+        return output;
+    }
+
+    Eigen::Index size() const { return weights.size() + bias.size(); }
+
+private:
+    Tensor3D weights;
+    Tensor1D bias;
+    DepthwiseOptions options;
+};
+
+template <typename T>
+class DepthwiseSeparableConv2D {
+public:
+    static constexpr Layout preferred_layout = Layout::NHWC;
+
+    using Tensor4D = typename DepthwiseConv2D<T>::Tensor4D;
+    using Tensor2D = Eigen::Tensor<T, 2, Eigen::RowMajor>;
+    using Tensor1D = typename DepthwiseConv2D<T>::Tensor1D;
+
+    // pointwise_weights: K x C; pointwise_activation follows the pointwise bias
+    DepthwiseSeparableConv2D(DepthwiseConv2D<T> depthwise_, Tensor2D pointwise_weights, Tensor1D pointwise_bias_,
+                             Activation pointwise_activation = Activation::Identity)
+        : depthwise(std::move(depthwise_)), pointwise(std::move(pointwise_weights)),
+          pointwise_bias(std::move(pointwise_bias_)), activation(pointwise_activation) {
+        if (pointwise.dimension(1) != depthwise.channels()) throw std::invalid_argument("Pointwise input channel mismatch");
+        if (pointwise_bias.size() != 0 && pointwise_bias.dimension(0) != pointwise.dimension(0)) throw std::invalid_argument("Bias size mismatch");
+    }
+
+    Tensor4D operator()(const Tensor4D &input) const {
+        depthwise.check_input(input);
+        const Eigen::Index N = input.dimension(0);
+        const Eigen::Index OH = depthwise.out_h(input.dimension(1));
+        const Eigen::Index OW = depthwise.out_w(input.dimension(2));
+        const Eigen::Index C = depthwise.channels();
+        const Eigen::Index K = pointwise.dimension(0);
+
+        const Eigen::Index row_bytes = OW * C * static_cast<Eigen::Index>(sizeof(T));
+        const Eigen::Index band_rows = std::clamp<Eigen::Index>(DEPTHWISE_BAND_BYTES / std::max<Eigen::Index>(row_bytes, 1), 1, OH);
+        const Eigen::Index bands = (OH + band_rows - 1) / band_rows;
+
+        Tensor4D output(N, OH, OW, K);
+        parallel_for(N * bands, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> mid(band_rows * OW * C);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index n = task / bands;
+                const Eigen::Index row_begin = (task % bands) * band_rows;
+                const Eigen::Index row_end = std::min(OH, row_begin + band_rows);
+                const Eigen::Index pixels = (row_end - row_begin) * OW;
+                depthwise.rows(input, n, row_begin, row_end, mid.data());
+
+                // out (K x pixels, column-major) = pointwise (K x C) * mid (C x pixels, column-major)
+                T *out = output.data() + ((n * OH + row_begin) * OW) * K;
+                gemm<T>(true, false, K, pixels, C, T(1), pointwise.data(), C, mid.data(), C, T(0), out, K);
+                pointwise_epilogue(out, pixels, K);
+            }
+        });
+        return output;
+    }
+
+    Eigen::Index size() const { return depthwise.size() + pointwise.size() + pointwise_bias.size(); }
+
+private:
+    void pointwise_epilogue(T *out, Eigen::Index pixels, Eigen::Index K) const {
+        using Array = Eigen::Array<T, Eigen::Dynamic, 1>;
+        for (Eigen::Index p = 0; p < pixels; ++p) {
+            Eigen::Map<Array> pixel(out + p * K, K);
+            if (pointwise_bias.size() != 0) pixel += Eigen::Map<const Array>(pointwise_bias.data(), K);
+            apply_activation(pixel.data(), K, activation);
+        }
+    }
+
+    DepthwiseConv2D<T> depthwise;
+    Tensor2D pointwise;
+    Tensor1D pointwise_bias;
+    Activation activation;
+};
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef __MY_DIRECT_CONV__
+#define __MY_DIRECT_CONV__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Core>
+
+#include "epilogue.hpp"
+#include "layout.hpp"
+#include "parallel.hpp"
+
+/*
+    Direct convolution with 8-channel register blocks, without im2col.
+
+    Filters are packed one output-channel block at a time, with channels in
+    blocks of CHANNEL_BLOCK = 8, innermost:
+        weights : C/8 x R x S x 8 (input channel) x 8 (output channel)
+    Channel counts that are not multiples of 8 are zero-padded.
+
+    The microkernel (DirectTile) computes a few output pixels x 8 output
+    channels of one output row, with all accumulators held in vector
+    registers. For every input channel and filter tap it broadcasts one input
+    value per pixel and multiply-adds it with the contiguous 8-wide weight
+    vector. The input is only ever read through scalar broadcasts, so the
+    kernel reads plain NCHW as well as blocked NCHW8c (DirectInput gives the
+    strides), and each finished tile is stored straight into the output.
+    Nothing is materialised besides the output: the only memory on top of
+    input, weights and output is one packed filter block per thread
+    (C * R * S * 8 values), against the per-thread patch buffers of banded
+    im2col (C * R * S * band rows * OW values).
+*/
+
+constexpr Eigen::Index CHANNEL_BLOCK = 8;
+
+inline Eigen::Index channel_blocks(Eigen::Index channels) { return (channels + CHANNEL_BLOCK - 1) / CHANNEL_BLOCK; }
+
+// Element strides of the input: image, channel block, channel within the block, row, pixel
+struct DirectInput {
+    Eigen::Index image, block, channel, row, pixel;
+
+    // N x C/8 x H x W x 8
+    static DirectInput blocked(Eigen::Index C, Eigen::Index H, Eigen::Index W) {
+        return {channel_blocks(C) * H * W * CHANNEL_BLOCK, H * W * CHANNEL_BLOCK, 1, W * CHANNEL_BLOCK, CHANNEL_BLOCK};
+    }
+    // N x C x H x W
+    static DirectInput nchw(Eigen::Index C, Eigen::Index H, Eigen::Index W) { return {C * H * W, CHANNEL_BLOCK * H * W, H * W, W, 1}; }
+};
+
+struct DirectGeometry {
+    Eigen::Index channels, height, width, kernel_h, kernel_w;
+    Eigen::Index stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w;
+
+    Eigen::Index blocks() const { return channel_blocks(channels); }
+    Eigen::Index out_h() const { return (height + 2 * pad_h - dilation_h * (kernel_h - 1) - 1) / stride_h + 1; }
+    Eigen::Index out_w() const { return (width + 2 * pad_w - dilation_w * (kernel_w - 1) - 1) / stride_w + 1; }
+};
+
+/*
+    Register tile of DirectTile<T>::width output pixels x 8 output channels.
+    The 8 channels are the widest Eigen packet dividing 8 (two SSE float
+    packets, one AVX float packet, four SSE double packets); the tile width
+    is chosen so the accumulators take 12 vector registers, leaving room for
+    the weight packets of one input channel.
+*/
+template <typename T>
+struct DirectTile {
+    using Packet = typename Eigen::internal::find_best_packet<T, CHANNEL_BLOCK>::type;
+    static constexpr int packet_size = Eigen::internal::unpacket_traits<Packet>::size;
+    static constexpr int packets = CHANNEL_BLOCK / packet_size;
+    static constexpr int width = std::max(1, std::min(8, 12 / packets));
+
+    Packet acc[width][packets];
+
+    /*
+        acc += contributions to pixels ow0 + p (p < count) of one output row,
+        whose filter taps start at input row ih0. in points at one image laid
+        out as described by st, w at one output-channel block
+        (C/8 x R x S x 8 x 8). Full tiles whose taps all fall inside the image
+        run with constant trip counts: per input channel one load of the
+        weight packets, then one broadcast multiply-add per pixel and packet.
+        Border taps are checked.
+    */
+    void accumulate(const T *in, const DirectInput &st, const T *w, const DirectGeometry &g, Eigen::Index ih0, Eigen::Index ow0, int count) {
+        using namespace Eigen::internal;
+        constexpr int VL = CHANNEL_BLOCK;
+
+        for (Eigen::Index cb = 0; cb < g.blocks(); ++cb) {
+            // channels past C are padding: zero weights, and absent from NCHW input
+            const int used = static_cast<int>(std::min<Eigen::Index>(VL, g.channels - cb * VL));
+            for (Eigen::Index r = 0; r < g.kernel_h; ++r) {
+                const Eigen::Index ih = ih0 + r * g.dilation_h;
+                if (ih < 0 || ih >= g.height) continue;
+                const T *in_row = in + cb * st.block + ih * st.row;
+                for (Eigen::Index s = 0; s < g.kernel_w; ++s) {
+                    const T *ws = w + ((cb * g.kernel_h + r) * g.kernel_w + s) * VL * VL;
+                    const Eigen::Index iw0 = ow0 * g.stride_w - g.pad_w + s * g.dilation_w;
+                    if (count == width && iw0 >= 0 && iw0 + (width - 1) * g.stride_w < g.width) {
+                        const Eigen::Index step = g.stride_w * st.pixel;
+                        for (int ci = 0; ci < used; ++ci) {
+                            const T *x = in_row + iw0 * st.pixel + ci * st.channel;
+                            Packet wk[packets];
+                            for (int j = 0; j < packets; ++j) wk[j] = ploadu<Packet>(ws + ci * VL + j * packet_size);
+                            for (int p = 0; p < width; ++p) {
+                                const Packet xp = pset1<Packet>(x[p * step]);
+                                for (int j = 0; j < packets; ++j) acc[p][j] = pmadd(xp, wk[j], acc[p][j]);
+                            }
+                        }
+                    } else {
+                        for (int p = 0; p < count; ++p) {
+                            const Eigen::Index iw = iw0 + p * g.stride_w;
+                            if (iw < 0 || iw >= g.width) continue;
+                            for (int ci = 0; ci < used; ++ci) {
+                                const Packet xp = pset1<Packet>(in_row[iw * st.pixel + ci * st.channel]);
+                                for (int j = 0; j < packets; ++j) {
+                                    acc[p][j] = pmadd(xp, ploadu<Packet>(ws + ci * VL + j * packet_size), acc[p][j]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+template <typename T>
+class DirectConvolution {
+public:
+    static constexpr Layout preferred_layout = Layout::NCHW8c;
+
+    DirectConvolution(Eigen::Index filters, Eigen::Index channels, Eigen::Index kernel_h, Eigen::Index kernel_w)
+        : K(filters), C(channels), R(kernel_h), S(kernel_w) {}
+
+    DirectGeometry geometry(Eigen::Index H, Eigen::Index W, Eigen::Index stride_h, Eigen::Index stride_w, Eigen::Index pad_h,
+                            Eigen::Index pad_w, Eigen::Index dilation_h = 1, Eigen::Index dilation_w = 1) const {
+        DirectGeometry g{C, H, W, R, S, stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w};
+        if (g.out_h() <= 0 || g.out_w() <= 0) throw std::invalid_argument("Kernel larger than padded input");
+        return g;
+    }
+
+    /*
+        Blocked path. input: N x C/8 x H x W x 8, output: N x K/8 x OH x OW x 8.
+        bias (K values) may be null; padded output channels are set to zero
+        after the activation.
+    */
+    void blocked(const T *input, Eigen::Index N, const DirectGeometry &g, const T *weights, const T *bias, Activation activation,
+                 T *output) const {
+        constexpr int VL = CHANNEL_BLOCK;
+        const Eigen::Index KB = channel_blocks(K);
+        const Eigen::Index OH = g.out_h(), OW = g.out_w();
+        run(input, DirectInput::blocked(C, g.height, g.width), N, g, weights, bias, [&](Eigen::Index n, Eigen::Index kb, Eigen::Index oh, Eigen::Index ow0,
+                                                                            int count, const T *tile) {
+            T *out = output + ((n * KB + kb) * OH + oh) * OW * VL;
+            std::copy(tile, tile + count * VL, out + ow0 * VL);
+            if (ow0 + count < OW) return;
+            apply_activation(out, OW * VL, activation);
+            const Eigen::Index used = std::min<Eigen::Index>(VL, K - kb * VL);
+            for (Eigen::Index ow = 0; used < VL && ow < OW; ++ow) std::fill(out + ow * VL + used, out + (ow + 1) * VL, T(0));
+        });
+    }
+
+    // NCHW path: input N x C x H x W, output N x K x OH x OW, read and written in place
+    void operator()(const T *input, Eigen::Index N, const DirectGeometry &g, const T *weights, const T *bias, Activation activation,
+                    T *output) const {
+        constexpr int VL = CHANNEL_BLOCK;
+        const Eigen::Index OH = g.out_h(), OW = g.out_w();
+        run(input, DirectInput::nchw(C, g.height, g.width), N, g, weights, bias, [&](Eigen::Index n, Eigen::Index kb, Eigen::Index oh, Eigen::Index ow0,
+                                                                         int count, const T *tile) {
+            const Eigen::Index used = std::min<Eigen::Index>(VL, K - kb * VL);
+            for (Eigen::Index k = 0; k < used; ++k) {
+                T *out = output + ((n * K + kb * VL + k) * OH + oh) * OW;
+                for (int p = 0; p < count; ++p) out[ow0 + p] = tile[p * VL + k];
+                if (ow0 + count == OW) apply_activation(out, OW, activation);
+            }
+        });
+    }
+
+    // Bytes of one packed output-channel block, the only scratch of a thread
+    Eigen::Index scratch_bytes() const { return filter_block() * static_cast<Eigen::Index>(sizeof(T)); }
+
+private:
+    Eigen::Index filter_block() const { return channel_blocks(C) * R * S * CHANNEL_BLOCK * CHANNEL_BLOCK; }
+
+    // Output-channel block kb of weights (K x C x R x S, row-major) as C/8 x R x S x 8 x 8, zero-padded
+    void pack(const T *weights, Eigen::Index kb, T *block) const {
+        constexpr int VL = CHANNEL_BLOCK;
+        std::fill(block, block + filter_block(), T(0));
+        for (Eigen::Index k = 0; k < std::min<Eigen::Index>(VL, K - kb * VL); ++k) {
+            for (Eigen::Index c = 0; c < C; ++c) {
+                const T *w = weights + ((kb * VL + k) * C + c) * R * S;
+                for (Eigen::Index rs = 0; rs < R * S; ++rs) block[(((c / VL) * R * S + rs) * VL + c % VL) * VL + k] = w[rs];
+            }
+        }
+    }
+
+    /*
+        One task per output row of one output-channel block: the block's
+        weights and the R input rows it reads stay in L1/L2 across the row.
+        Tasks run output-channel block by block, so a thread packs a block's
+        filters into its scratch only when its run of tasks reaches the next
+        block. store(n, kb, oh, ow0, count, tile) receives each tile as count
+        pixels x 8 channels, left to right; the last one of a row has
+        ow0 + count == OW.
+    */
+    template <typename Store>
+    void run(const T *input, const DirectInput &st, Eigen::Index N, const DirectGeometry &g, const T *weights, const T *bias,
+             Store &&store) const {
+        using Tile = DirectTile<T>;
+        using Packet = typename Tile::Packet;
+        constexpr int VL = CHANNEL_BLOCK;
+        const Eigen::Index KB = channel_blocks(K);
+        const Eigen::Index OH = g.out_h(), OW = g.out_w();
+
+        parallel_for(KB * N * OH, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> packed(filter_block());
+            Eigen::Index packed_kb = -1;
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index oh = task % OH;
+                const Eigen::Index n = (task / OH) % N;
+                const Eigen::Index kb = task / (OH * N);
+                if (kb != packed_kb) {
+                    pack(weights, kb, packed.data());
+                    packed_kb = kb;
+                }
+
+                T b[VL];
+                for (int k = 0; k < VL; ++k) {
+                    const Eigen::Index channel = kb * VL + k;
+                    b[k] = bias != nullptr && channel < K ? bias[channel] : T(0);
+                }
+                for (Eigen::Index ow0 = 0; ow0 < OW; ow0 += Tile::width) {
+                    const int count = static_cast<int>(std::min<Eigen::Index>(Tile::width, OW - ow0));
+                    Tile tile;
+                    for (int p = 0; p < Tile::width; ++p) {
+                        for (int j = 0; j < Tile::packets; ++j) tile.acc[p][j] = Eigen::internal::ploadu<Packet>(b + j * Tile::packet_size);
+                    }
+                    tile.accumulate(input + n * st.image, st, packed.data(), g, oh * g.stride_h - g.pad_h, ow0, count);
+                    T values[Tile::width * VL];
+                    for (int p = 0; p < count; ++p) {
+                        for (int j = 0; j < Tile::packets; ++j) Eigen::internal::pstoreu(values + p * VL + j * Tile::packet_size, tile.acc[p][j]);
+                    }
+                    store(n, kb, oh, ow0, count, values);
+                }
+            }
+        });
+    }
+
+    Eigen::Index K, C, R, S;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __MY_EPILOGUE__
+#define __MY_EPILOGUE__
+
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Core>
+
+/*
+    Elementwise tails fused onto the end of the convolution kernels: they run
+    on a freshly written span of output while it is still in cache.
+*/
+
+enum class Activation { Identity, ReLU, Sigmoid, Tanh };
+
+template <typename T>
+void apply_activation(T *data, Eigen::Index size, Activation activation) {
+    switch (activation) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            for (Eigen::Index i = 0; i < size; ++i) data[i] = std::max(data[i], T(0));
+            break;
+        case Activation::Sigmoid:
+            for (Eigen::Index i = 0; i < size; ++i) data[i] = T(1) / (T(1) + std::exp(-data[i]));
+            break;
+        case Activation::Tanh:
+            for (Eigen::Index i = 0; i < size; ++i) data[i] = std::tanh(data[i]);
+            break;
+    }
+}
+
+// out[i] = activation(out[i] + bias) over [0, size); bias is skipped when has_bias is false
+template <typename T>
+void bias_activation(T *data, Eigen::Index size, bool has_bias, T bias, Activation activation) {
+    if (has_bias) {
+        for (Eigen::Index i = 0; i < size; ++i) data[i] += bias;
+    }
+    apply_activation(data, size, activation);
+}
+
+// grad[i] *= activation'(x[i]), written in terms of the activation's output y[i] = activation(x[i])
+template <typename T>
+void activation_backward(const T *output, T *grad, Eigen::Index size, Activation activation) {
+    switch (activation) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            for (Eigen::Index i = 0; i < size; ++i) grad[i] = output[i] > T(0) ? grad[i] : T(0);
+            break;
+        case Activation::Sigmoid:
+            for (Eigen::Index i = 0; i < size; ++i) grad[i] *= output[i] * (T(1) - output[i]);
+            break;
+        case Activation::Tanh:
+            for (Eigen::Index i = 0; i < size; ++i) grad[i] *= T(1) - output[i] * output[i];
+            break;
+    }
+}
+
+#endif
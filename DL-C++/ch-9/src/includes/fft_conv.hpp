@@ -0,0 +1,271 @@
+#ifndef __MY_FFT_CONV__
+#define __MY_FFT_CONV__
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+#include "epilogue.hpp"
+#include "parallel.hpp"
+
+/*
+    FFT convolution for large kernels (stride 1, no dilation).
+
+    Cross-correlating with an R x S filter is linear convolution with the
+    flipped filter. The padded image is cut into B_h x B_w blocks. Each block
+    and the flipped filters are zero-padded to L_h x L_w, where
+    L >= B + kernel - 1, so the circular convolution of the FFT equals the
+    linear one. Each block's result is added into the output at the block's
+    offset (overlap-add). In the frequency domain the sum over input channels
+    is a pointwise multiply-accumulate:
+        Y_k = sum_c W_kc .* X_c
+    so each block costs C forward and K inverse FFTs plus K*C pointwise
+    products, whatever the kernel size.
+
+    Real 2-D transforms are stored as half spectra, L_h x (L_w / 2 + 1). Rows
+    are done with Eigen's real FFT and columns with its complex FFT. The
+    filter spectra depend only on (L_h, L_w). They are computed on first use
+    of a tile size, cached, and carry the 1 / (L_h * L_w) inverse scale.
+*/
+
+// Smallest n >= size of the form 2^a 3^b 5^c, with a >= 2 when multiple_of_4
+inline Eigen::Index next_fast_fft_size(Eigen::Index size, bool multiple_of_4 = false) {
+    for (Eigen::Index n = std::max<Eigen::Index>(size, 1);; ++n) {
+        if (multiple_of_4 && n % 4 != 0) continue;
+        Eigen::Index m = n;
+        for (Eigen::Index p : {2, 3, 5}) {
+            while (m % p == 0) m /= p;
+        }
+        if (m == 1) return n;
+    }
+}
+
+// Transform length along one dimension. Inputs that fit in FFT_MAX_SINGLE_TILE
+// are done as one block; otherwise the transform is about 8x the kernel
+// overlap, so little of each tile is spent on the overlap.
+constexpr Eigen::Index FFT_MAX_SINGLE_TILE = 128;
+constexpr Eigen::Index FFT_MIN_TILE = 32;
+
+inline Eigen::Index fft_tile_length(Eigen::Index padded_size, Eigen::Index kernel, bool multiple_of_4) {
+    const Eigen::Index single = next_fast_fft_size(padded_size + kernel - 1, multiple_of_4);
+    if (single <= FFT_MAX_SINGLE_TILE) return single;
+    return next_fast_fft_size(std::max(FFT_MIN_TILE, 8 * (kernel - 1)), multiple_of_4);
+}
+
+/*
+    Cost model behind the automatic choice, in units of one im2col GEMM
+    multiply-add. im2col does OH * OW * R * S * C * K of them, plus the
+    unrolling itself, OH * OW * R * S * C copies (which dominate when K is
+    small). Per tile the
+    FFT path does C + K 2-D transforms of about L log2(L) butterflies each
+    (L = L_h * L_w) and C * K complex multiply-adds on the half spectrum.
+    The weights are the cost of each relative to a GEMM multiply-add, fitted
+    on fft_benchmark runs: Eigen's FFT is scalar code, and the spectral
+    products stream the whole filter spectrum from memory once per tile.
+*/
+constexpr double IM2COL_COPY_COST = 2.0;
+constexpr double FFT_BUTTERFLY_COST = 16.0;
+constexpr double FFT_COMPLEX_MAC_COST = 8.0;
+
+inline double im2col_conv_cost(Eigen::Index H, Eigen::Index W, Eigen::Index pad_h, Eigen::Index pad_w,
+                               Eigen::Index R, Eigen::Index S, Eigen::Index C, Eigen::Index K) {
+    const double OH = static_cast<double>(H + 2 * pad_h - R + 1);
+    const double OW = static_cast<double>(W + 2 * pad_w - S + 1);
+    return OH * OW * static_cast<double>(R * S * C) * (static_cast<double>(K) + IM2COL_COPY_COST);
+}
+
+inline double fft_conv_cost(Eigen::Index H, Eigen::Index W, Eigen::Index pad_h, Eigen::Index pad_w,
+                            Eigen::Index R, Eigen::Index S, Eigen::Index C, Eigen::Index K) {
+    const Eigen::Index Hp = H + 2 * pad_h;
+    const Eigen::Index Wp = W + 2 * pad_w;
+    const Eigen::Index Lh = fft_tile_length(Hp, R, false);
+    const Eigen::Index Lw = fft_tile_length(Wp, S, true);
+    const double tiles = static_cast<double>(((Hp + Lh - R) / (Lh - R + 1)) * ((Wp + Lw - S) / (Lw - S + 1)));
+    const double L = static_cast<double>(Lh * Lw);
+    const double transforms = static_cast<double>(C + K) * 0.5 * L * std::log2(L);
+    const double products = static_cast<double>(C * K) * static_cast<double>(Lh * (Lw / 2 + 1));
+    return tiles * (FFT_BUTTERFLY_COST * transforms + FFT_COMPLEX_MAC_COST * products);
+}
+
+template <typename T>
+class FFTConvolution {
+public:
+    using Complex = std::complex<T>;
+    using ComplexArray = Eigen::Array<Complex, Eigen::Dynamic, 1>;
+
+    // weights: K x C/groups x R x S, row-major
+    FFTConvolution(const T *weights, Eigen::Index filters, Eigen::Index group_channels, Eigen::Index groups_,
+                   Eigen::Index kernel_h, Eigen::Index kernel_w)
+        : K(filters), Cg(group_channels), groups(groups_), Kg(filters / groups_), R(kernel_h), S(kernel_w),
+          filter(weights, weights + filters * group_channels * kernel_h * kernel_w) {}
+
+    /*
+        input: N x C x H x W, output: N x K x OH x OW (row-major), with
+        OH = H + 2 * pad_h - R + 1 and OW = W + 2 * pad_w - S + 1. bias may be null.
+    */
+    void operator()(const T *input, Eigen::Index N, Eigen::Index H, Eigen::Index W, Eigen::Index pad_h, Eigen::Index pad_w,
+                    const T *bias, Activation activation, T *output) const {
+        const Eigen::Index Hp = H + 2 * pad_h;
+        const Eigen::Index Wp = W + 2 * pad_w;
+        const Eigen::Index OH = Hp - R + 1;
+        const Eigen::Index OW = Wp - S + 1;
+        if (OH <= 0 || OW <= 0) throw std::invalid_argument("Kernel larger than padded input");
+
+        const Eigen::Index Lh = fft_tile_length(Hp, R, false);
+        const Eigen::Index Lw = fft_tile_length(Wp, S, true);
+        const Eigen::Index Bh = Lh - R + 1;
+        const Eigen::Index Bw = Lw - S + 1;
+        const Eigen::Index Fw = Lw / 2 + 1;
+        const Eigen::Index F = Lh * Fw;
+        const Eigen::Index tile_rows = (Hp + Bh - 1) / Bh;
+        const Eigen::Index tile_cols = (Wp + Bw - 1) / Bw;
+        const ComplexArray &spectra = filter_spectra(Lh, Lw);
+
+        std::fill(output, output + N * K * OH * OW, T(0));
+
+        // Blocks in neighbouring tile rows overlap by R - 1 output rows (Bh >= R - 1),
+        // so even tile rows run in parallel first and odd ones second: no two
+        // threads ever add into the same output, and every output receives its
+        // contributions in the same order.
+        for (Eigen::Index parity = 0; parity < 2; ++parity) {
+            const Eigen::Index rows = (tile_rows - parity + 1) / 2;
+            parallel_for(N * groups * rows, [&](Eigen::Index first, Eigen::Index last) {
+                Eigen::FFT<T> fft;
+                fft.SetFlag(Eigen::FFT<T>::HalfSpectrum);
+                fft.SetFlag(Eigen::FFT<T>::Unscaled);
+                ComplexArray X(Cg * F), Y(F);
+                std::vector<T> tile(Lh * Lw);
+                std::vector<Complex> column(Lh), column_out(Lh);
+
+                for (Eigen::Index task = first; task < last; ++task) {
+                    const Eigen::Index tile_row = 2 * (task % rows) + parity;
+                    const Eigen::Index group = (task / rows) % groups;
+                    const Eigen::Index n = task / (rows * groups);
+                    const Eigen::Index row0 = tile_row * Bh;
+
+                    for (Eigen::Index tile_col = 0; tile_col < tile_cols; ++tile_col) {
+                        const Eigen::Index col0 = tile_col * Bw;
+                        for (Eigen::Index c = 0; c < Cg; ++c) {
+                            const T *plane = input + ((n * groups + group) * Cg + c) * H * W;
+                            load_block(plane, H, W, row0 - pad_h, col0 - pad_w, std::min(Bh, Hp - row0), std::min(Bw, Wp - col0),
+                                       Lh, Lw, tile.data());
+                            forward(fft, tile.data(), Lh, Lw, X.data() + c * F, column, column_out);
+                        }
+
+                        for (Eigen::Index k = 0; k < Kg; ++k) {
+                            const Complex *w = spectra.data() + ((group * Kg + k) * Cg) * F;
+                            Y = X.segment(0, F) * Eigen::Map<const ComplexArray>(w, F);
+                            for (Eigen::Index c = 1; c < Cg; ++c) {
+                                Y += X.segment(c * F, F) * Eigen::Map<const ComplexArray>(w + c * F, F);
+                            }
+                            inverse(fft, Y.data(), Lh, Lw, tile.data(), column, column_out);
+
+                            // Full-convolution index y maps to output index y - (R - 1)
+                            T *plane = output + (n * K + group * Kg + k) * OH * OW;
+                            const Eigen::Index j_begin = std::max<Eigen::Index>(0, (S - 1) - col0);
+                            const Eigen::Index j_end = std::min<Eigen::Index>(Lw, OW + (S - 1) - col0);
+                            for (Eigen::Index i = 0; i < Lh; ++i) {
+                                const Eigen::Index oh = row0 + i - (R - 1);
+                                if (oh < 0 || oh >= OH) continue;
+                                T *dst = plane + oh * OW;
+                                const T *src = tile.data() + i * Lw;
+                                for (Eigen::Index j = j_begin; j < j_end; ++j) dst[col0 + j - (S - 1)] += src[j];
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        parallel_for(N * K, [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index plane = first; plane < last; ++plane) {
+                const Eigen::Index k = plane % K;
+                bias_activation(output + plane * OH * OW, OH * OW, bias != nullptr, bias ? bias[k] : T(0), activation);
+            }
+        });
+    }
+
+private:
+    // Copies a rows x cols block at (row, col) of the padded image into an
+    // Lh x Lw tile, zero elsewhere
+    static void load_block(const T *plane, Eigen::Index H, Eigen::Index W, Eigen::Index row, Eigen::Index col,
+                           Eigen::Index rows, Eigen::Index cols, Eigen::Index Lh, Eigen::Index Lw, T *tile) {
+        std::fill(tile, tile + Lh * Lw, T(0));
+        const Eigen::Index j_begin = std::max<Eigen::Index>(0, -col);
+        const Eigen::Index j_end = std::min<Eigen::Index>(cols, W - col);
+        for (Eigen::Index i = 0; i < rows; ++i) {
+            const Eigen::Index ih = row + i;
+            if (ih < 0 || ih >= H || j_begin >= j_end) continue;
+            std::copy(plane + ih * W + col + j_begin, plane + ih * W + col + j_end, tile + i * Lw + j_begin);
+        }
+    }
+
+    // Lh x Lw real tile -> Lh x (Lw/2 + 1) half spectrum
+    static void forward(Eigen::FFT<T> &fft, const T *tile, Eigen::Index Lh, Eigen::Index Lw, Complex *spectrum,
+                        std::vector<Complex> &column, std::vector<Complex> &column_out) {
+        const Eigen::Index Fw = Lw / 2 + 1;
+        for (Eigen::Index i = 0; i < Lh; ++i) fft.fwd(spectrum + i * Fw, tile + i * Lw, Lw);
+        if (Lh == 1) return;
+        for (Eigen::Index v = 0; v < Fw; ++v) {
+            for (Eigen::Index i = 0; i < Lh; ++i) column[i] = spectrum[i * Fw + v];
+            fft.fwd(column_out.data(), column.data(), Lh);
+            for (Eigen::Index i = 0; i < Lh; ++i) spectrum[i * Fw + v] = column_out[i];
+        }
+    }
+
+    // Inverse of forward() (unscaled); the spectrum is overwritten
+    static void inverse(Eigen::FFT<T> &fft, Complex *spectrum, Eigen::Index Lh, Eigen::Index Lw, T *tile,
+                        std::vector<Complex> &column, std::vector<Complex> &column_out) {
+        const Eigen::Index Fw = Lw / 2 + 1;
+        if (Lh > 1) {
+            for (Eigen::Index v = 0; v < Fw; ++v) {
+                for (Eigen::Index i = 0; i < Lh; ++i) column[i] = spectrum[i * Fw + v];
+                fft.inv(column_out.data(), column.data(), Lh);
+                for (Eigen::Index i = 0; i < Lh; ++i) spectrum[i * Fw + v] = column_out[i];
+            }
+        }
+        for (Eigen::Index i = 0; i < Lh; ++i) fft.inv(tile + i * Lw, spectrum + i * Fw, Lw);
+    }
+
+    // K x Cg spectra of the flipped filters for an Lh x Lw transform, scaled by 1 / (Lh * Lw)
+    const ComplexArray &filter_spectra(Eigen::Index Lh, Eigen::Index Lw) const {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto &entry = spectra_cache[{Lh, Lw}];
+        if (entry) return *entry;
+
+        const Eigen::Index F = Lh * (Lw / 2 + 1);
+        auto spectra = std::make_shared<ComplexArray>(K * Cg * F);
+        Eigen::FFT<T> fft;
+        fft.SetFlag(Eigen::FFT<T>::HalfSpectrum);
+        fft.SetFlag(Eigen::FFT<T>::Unscaled);
+        std::vector<T> tile(Lh * Lw);
+        std::vector<Complex> column(Lh), column_out(Lh);
+        const T scale = T(1) / static_cast<T>(Lh * Lw);
+
+        for (Eigen::Index kc = 0; kc < K * Cg; ++kc) {
+            const T *g = filter.data() + kc * R * S;
+            std::fill(tile.begin(), tile.end(), T(0));
+            for (Eigen::Index r = 0; r < R; ++r) {
+                for (Eigen::Index s = 0; s < S; ++s) tile[(R - 1 - r) * Lw + (S - 1 - s)] = g[r * S + s] * scale;
+            }
+            forward(fft, tile.data(), Lh, Lw, spectra->data() + kc * F, column, column_out);
+        }
+        entry = spectra;
+        return *entry;
+    }
+
+    Eigen::Index K, Cg, groups, Kg, R, S;
+    std::vector<T> filter;
+    mutable std::mutex cache_mutex;
+    mutable std::map<std::pair<Eigen::Index, Eigen::Index>, std::shared_ptr<const ComplexArray>> spectra_cache;
+};
+
+#endif
@@ -0,0 +1,281 @@
+#ifndef __MY_LAYOUT__
+#define __MY_LAYOUT__
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+#include "parallel.hpp"
+
+/*
+    Activation tensor layouts and the conversions between them.
+
+        NCHW     N x C x H x W            Conv2D, ConvTranspose2D, pooling
+        NHWC     N x H x W x C            depthwise convolution, OpenCV images
+        NCHW8c   N x C/8 x H x W x 8      DirectConvolution
+        NCHW16c  N x C/16 x H x W x 16
+
+    Blocked layouts zero-pad C up to a multiple of the block. Each layer
+    declares the layout it runs in as preferred_layout; LayoutTensor carries
+    its layout with it, and to() is free when the layout already matches, so
+    a chain of layers converts only where consecutive preferences differ.
+
+    NCHW <-> NHWC is a C x HW transpose per image and NCHW <-> NCHWc one
+    c x HW transpose per channel block. Both run on transpose(), which walks
+    the matrix in cache tiles and transposes packet-square blocks in
+    registers (Eigen's ptranspose: 4x4 floats on SSE, 8x8 on AVX).
+    NHWC <-> NCHWc only regroups contiguous runs of channels.
+*/
+
+enum class Layout { NCHW, NHWC, NCHW8c, NCHW16c };
+
+// Channels per block of a blocked layout, 1 for the plain ones
+inline Eigen::Index layout_block(Layout layout) {
+    switch (layout) {
+        case Layout::NCHW8c: return 8;
+        case Layout::NCHW16c: return 16;
+        default: return 1;
+    }
+}
+
+inline bool is_blocked(Layout layout) { return layout_block(layout) > 1; }
+
+inline const char *layout_name(Layout layout) {
+    switch (layout) {
+        case Layout::NCHW: return "NCHW";
+        case Layout::NHWC: return "NHWC";
+        case Layout::NCHW8c: return "NCHW8c";
+        case Layout::NCHW16c: return "NCHW16c";
+    }
+    return "?";
+}
+
+// Side of the square tiles transpose() walks; two float tiles fit in L1 many times over
+constexpr Eigen::Index TRANSPOSE_TILE = 32;
+
+// PacketBlock<__m128, 4> drops the vector type's alignment attribute, which is harmless here
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
+// dst (cols x rows, leading dimension ld_dst) = src^T (rows x cols, leading dimension ld_src), row-major
+template <typename T>
+void transpose(const T *src, Eigen::Index rows, Eigen::Index cols, Eigen::Index ld_src, T *dst, Eigen::Index ld_dst) {
+    using namespace Eigen::internal;
+    using Packet = typename packet_traits<T>::type;
+    constexpr Eigen::Index PS = packet_traits<T>::size;
+
+    for (Eigen::Index i0 = 0; i0 < rows; i0 += TRANSPOSE_TILE) {
+        const Eigen::Index i1 = std::min(rows, i0 + TRANSPOSE_TILE);
+        for (Eigen::Index j0 = 0; j0 < cols; j0 += TRANSPOSE_TILE) {
+            const Eigen::Index j1 = std::min(cols, j0 + TRANSPOSE_TILE);
+            Eigen::Index i = i0;
+            if constexpr (PS > 1) {
+                for (; i + PS <= i1; i += PS) {
+                    Eigen::Index j = j0;
+                    for (; j + PS <= j1; j += PS) {
+                        PacketBlock<Packet, PS> block;
+                        for (Eigen::Index k = 0; k < PS; ++k) block.packet[k] = ploadu<Packet>(src + (i + k) * ld_src + j);
+                        ptranspose(block);
+                        for (Eigen::Index k = 0; k < PS; ++k) pstoreu(dst + (j + k) * ld_dst + i, block.packet[k]);
+                    }
+                    for (; j < j1; ++j) {
+                        for (Eigen::Index k = 0; k < PS; ++k) dst[j * ld_dst + i + k] = src[(i + k) * ld_src + j];
+                    }
+                }
+            }
+            for (; i < i1; ++i) {
+                for (Eigen::Index j = j0; j < j1; ++j) dst[j * ld_dst + i] = src[i * ld_src + j];
+            }
+        }
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// N x C x HW -> N x HW x C
+template <typename T>
+void nchw_to_nhwc(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, T *dst) {
+    parallel_for(N, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index n = first; n < last; ++n) transpose(src + n * C * HW, C, HW, HW, dst + n * C * HW, C);
+    });
+}
+
+// N x HW x C -> N x C x HW
+template <typename T>
+void nhwc_to_nchw(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, T *dst) {
+    parallel_for(N, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index n = first; n < last; ++n) transpose(src + n * C * HW, HW, C, C, dst + n * C * HW, HW);
+    });
+}
+
+// N x C x HW -> N x C/b x HW x b, zero-filling the padded channels
+template <typename T>
+void nchw_to_blocked(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, Eigen::Index b, T *dst) {
+    const Eigen::Index CB = (C + b - 1) / b;
+    parallel_for(N * CB, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index task = first; task < last; ++task) {
+            const Eigen::Index n = task / CB, cb = task % CB;
+            const Eigen::Index used = std::min(b, C - cb * b);
+            T *block = dst + task * HW * b;
+            if (used < b) {
+                for (Eigen::Index p = 0; p < HW; ++p) std::fill(block + p * b + used, block + (p + 1) * b, T(0));
+            }
+            transpose(src + (n * C + cb * b) * HW, used, HW, HW, block, b);
+        }
+    });
+}
+
+// N x C/b x HW x b -> N x C x HW, dropping the padded channels
+template <typename T>
+void blocked_to_nchw(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, Eigen::Index b, T *dst) {
+    const Eigen::Index CB = (C + b - 1) / b;
+    parallel_for(N * CB, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index task = first; task < last; ++task) {
+            const Eigen::Index n = task / CB, cb = task % CB;
+            transpose(src + task * HW * b, HW, std::min(b, C - cb * b), b, dst + (n * C + cb * b) * HW, HW);
+        }
+    });
+}
+
+// N x HW x C -> N x C/b x HW x b
+template <typename T>
+void nhwc_to_blocked(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, Eigen::Index b, T *dst) {
+    const Eigen::Index CB = (C + b - 1) / b;
+    parallel_for(N * CB, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index task = first; task < last; ++task) {
+            const Eigen::Index n = task / CB, cb = task % CB;
+            const Eigen::Index used = std::min(b, C - cb * b);
+            const T *pixels = src + n * HW * C + cb * b;
+            T *block = dst + task * HW * b;
+            for (Eigen::Index p = 0; p < HW; ++p) {
+                std::copy(pixels + p * C, pixels + p * C + used, block + p * b);
+                std::fill(block + p * b + used, block + (p + 1) * b, T(0));
+            }
+        }
+    });
+}
+
+// N x C/b x HW x b -> N x HW x C
+template <typename T>
+void blocked_to_nhwc(const T *src, Eigen::Index N, Eigen::Index C, Eigen::Index HW, Eigen::Index b, T *dst) {
+    const Eigen::Index CB = (C + b - 1) / b;
+    parallel_for(N * HW, [&](Eigen::Index first, Eigen::Index last) {
+        for (Eigen::Index task = first; task < last; ++task) {
+            const Eigen::Index n = task / HW, p = task % HW;
+            T *pixel = dst + task * C;
+            for (Eigen::Index cb = 0; cb < CB; ++cb) {
+                const T *block = src + ((n * CB + cb) * HW + p) * b;
+                std::copy(block, block + std::min(b, C - cb * b), pixel + cb * b);
+            }
+        }
+    });
+}
+
+/*
+    An N x C x H x W activation stored in one of the layouts. Plain layouts
+    keep a 4-D tensor with the physical dimension order (N x C x H x W or
+    N x H x W x C), so layers that take Eigen tensors run on it without a
+    copy; blocked layouts keep a 5-D N x C/b x H x W x b tensor.
+*/
+template <typename T>
+class LayoutTensor {
+public:
+    using Tensor4D = Eigen::Tensor<T, 4, Eigen::RowMajor>;
+    using Tensor5D = Eigen::Tensor<T, 5, Eigen::RowMajor>;
+
+    LayoutTensor() = default;
+
+    // Zero-initialised
+    LayoutTensor(Layout layout_, Eigen::Index N, Eigen::Index C, Eigen::Index H, Eigen::Index W)
+        : layout_tag(layout_), dims{N, C, H, W} {
+        if (layout_ == Layout::NCHW) plain = Tensor4D(N, C, H, W);
+        if (layout_ == Layout::NHWC) plain = Tensor4D(N, H, W, C);
+        if (is_blocked(layout_)) {
+            const Eigen::Index b = layout_block(layout_);
+            blocked = Tensor5D(N, (C + b - 1) / b, H, W, b);
+        }
+        std::fill(data(), data() + storage_size(), T(0));
+    }
+
+    // Takes a plain tensor whose dimensions are in layout_ order
+    LayoutTensor(Tensor4D tensor, Layout layout_) : layout_tag(layout_), plain(std::move(tensor)) {
+        if (is_blocked(layout_)) throw std::invalid_argument("A 4-D tensor cannot hold a blocked layout");
+        if (layout_ == Layout::NCHW) dims = {plain.dimension(0), plain.dimension(1), plain.dimension(2), plain.dimension(3)};
+        else dims = {plain.dimension(0), plain.dimension(3), plain.dimension(1), plain.dimension(2)};
+    }
+
+    Layout layout() const { return layout_tag; }
+    Eigen::Index batch() const { return dims[0]; }
+    Eigen::Index channels() const { return dims[1]; }
+    Eigen::Index height() const { return dims[2]; }
+    Eigen::Index width() const { return dims[3]; }
+
+    T *data() { return is_blocked(layout_tag) ? blocked.data() : plain.data(); }
+    const T *data() const { return is_blocked(layout_tag) ? blocked.data() : plain.data(); }
+    Eigen::Index storage_size() const { return is_blocked(layout_tag) ? blocked.size() : plain.size(); }
+
+    // The plain NCHW or NHWC tensor
+    const Tensor4D &tensor() const {
+        if (is_blocked(layout_tag)) throw std::invalid_argument("Blocked layouts have no 4-D tensor");
+        return plain;
+    }
+
+    // Storage offset of logical element (n, c, h, w)
+    Eigen::Index offset(Eigen::Index n, Eigen::Index c, Eigen::Index h, Eigen::Index w) const {
+        const Eigen::Index C = dims[1], H = dims[2], W = dims[3];
+        switch (layout_tag) {
+            case Layout::NCHW: return ((n * C + c) * H + h) * W + w;
+            case Layout::NHWC: return ((n * H + h) * W + w) * C + c;
+            default: {
+                const Eigen::Index b = layout_block(layout_tag);
+                return ((((n * ((C + b - 1) / b) + c / b) * H + h) * W + w) * b) + c % b;
+            }
+        }
+    }
+
+    T &operator()(Eigen::Index n, Eigen::Index c, Eigen::Index h, Eigen::Index w) { return data()[offset(n, c, h, w)]; }
+    const T &operator()(Eigen::Index n, Eigen::Index c, Eigen::Index h, Eigen::Index w) const { return data()[offset(n, c, h, w)]; }
+
+    // This tensor in the target layout; a copy only when the layouts differ
+    LayoutTensor to(Layout target) const & {
+        if (target == layout_tag) return *this;
+        return convert(target);
+    }
+    LayoutTensor to(Layout target) && {
+        if (target == layout_tag) return std::move(*this);
+        return convert(target);
+    }
+
+private:
+    LayoutTensor convert(Layout target) const {
+        const Eigen::Index N = dims[0], C = dims[1], HW = dims[2] * dims[3];
+        const Eigen::Index from_b = layout_block(layout_tag), to_b = layout_block(target);
+        // Between block sizes, through the channel-contiguous layout
+        if (is_blocked(layout_tag) && is_blocked(target)) return convert(Layout::NHWC).convert(target);
+
+        LayoutTensor result(target, N, C, dims[2], dims[3]);
+        const T *src = data();
+        T *dst = result.data();
+
+        if (layout_tag == Layout::NCHW && target == Layout::NHWC) nchw_to_nhwc(src, N, C, HW, dst);
+        else if (layout_tag == Layout::NHWC && target == Layout::NCHW) nhwc_to_nchw(src, N, C, HW, dst);
+        else if (layout_tag == Layout::NCHW) nchw_to_blocked(src, N, C, HW, to_b, dst);
+        else if (layout_tag == Layout::NHWC) nhwc_to_blocked(src, N, C, HW, to_b, dst);
+        else if (target == Layout::NCHW) blocked_to_nchw(src, N, C, HW, from_b, dst);
+        else if (target == Layout::NHWC) blocked_to_nhwc(src, N, C, HW, from_b, dst);
+        return result;
+    }
+
+    Layout layout_tag = Layout::NCHW;
+    std::array<Eigen::Index, 4> dims{0, 0, 0, 0};
+    Tensor4D plain;
+    Tensor5D blocked;
+};
+
+#endif
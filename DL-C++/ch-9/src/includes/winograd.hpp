@@ -0,0 +1,272 @@
+#ifndef __MY_WINOGRAD__
+#define __MY_WINOGRAD__
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Core>
+
+#include "epilogue.hpp"
+#include "gemm.hpp"
+#include "parallel.hpp"
+
+/*
+    Winograd minimal filtering F(m x m, 3 x 3) for stride-1, undilated 3x3
+    convolutions (Lavin & Gray).
+
+    The output is cut into m x m tiles, each computed from an a x a input tile
+    (a = m + 2) as
+        Y = A^T [ (G g G^T) .* (B^T d B) ] A
+    The filter transform U = G g G^T is done once at construction. For every
+    one of the a*a transform coordinates the elementwise products summed over
+    input channels form a GEMM, (tiles x C) * (C x K), so a layer runs as a*a
+    independent GEMMs between the input and output transforms.
+
+    Multiplications per output for a 3x3 filter: 9 direct, 4 for F(2x2), 2.25
+    for F(4x4).
+
+    Numerical error budget. The transforms scale values by the interpolation
+    points (0, +-1 for F(2x2); 0, +-1, +-2 for F(4x4)), so rounding error
+    grows with m; the filter transform is done in double to keep its share
+    to one rounding. On float data uniform in [-1, 1], 3x3 filters, C = K
+    from 24 to 512 (winograd_benchmark), max |error| / max |output| against a
+    double im2col reference stays within
+        im2col    1.5e-6
+        F(2x2)    2e-6
+        F(4x4)    2e-6
+    and the budget the layer is held to is 1e-5 relative for F(4x4), 5e-6 for
+    F(2x2). Inputs with a large dynamic range across a tile lose more with
+    F(4x4); such layers can pin ConvAlgorithm::Im2col.
+*/
+
+template <int M>
+struct WinogradMatrices;
+
+template <>
+struct WinogradMatrices<2> {
+    static constexpr int alpha = 4;
+    static constexpr double BT[4][4] = {
+        {1, 0, -1, 0},
+        {0, 1, 1, 0},
+        {0, -1, 1, 0},
+        {0, 1, 0, -1}};
+    static constexpr double G[4][3] = {
+        {1, 0, 0},
+        {0.5, 0.5, 0.5},
+        {0.5, -0.5, 0.5},
+        {0, 0, 1}};
+    static constexpr double AT[2][4] = {
+        {1, 1, 1, 0},
+        {0, 1, -1, -1}};
+};
+
+template <>
+struct WinogradMatrices<4> {
+    static constexpr int alpha = 6;
+    static constexpr double BT[6][6] = {
+        {4, 0, -5, 0, 1, 0},
+        {0, -4, -4, 1, 1, 0},
+        {0, 4, -4, -1, 1, 0},
+        {0, -2, -1, 2, 1, 0},
+        {0, 2, -1, -2, 1, 0},
+        {0, 4, 0, -5, 0, 1}};
+    static constexpr double G[6][3] = {
+        {1. / 4, 0, 0},
+        {-1. / 6, -1. / 6, -1. / 6},
+        {-1. / 6, 1. / 6, -1. / 6},
+        {1. / 24, 1. / 12, 1. / 6},
+        {1. / 24, -1. / 12, 1. / 6},
+        {0, 0, 1}};
+    static constexpr double AT[4][6] = {
+        {1, 1, 1, 1, 1, 0},
+        {0, 1, -1, 2, -2, 0},
+        {0, 1, 1, 4, 4, 0},
+        {0, 1, -1, 8, -8, 1}};
+};
+
+// Bytes of transformed input + GEMM output kept per block of tiles, and the
+// fewest tiles per block (the GEMM row count) when channels are many
+constexpr Eigen::Index WINOGRAD_BLOCK_BYTES = 512 * 1024;
+constexpr Eigen::Index WINOGRAD_MIN_BLOCK = 32;
+
+template <typename T, int M>
+class WinogradConvolution {
+public:
+    using Matrices = WinogradMatrices<M>;
+    static constexpr int alpha = Matrices::alpha;
+    static constexpr int A2 = alpha * alpha;
+
+    // weights: K x C/groups x 3 x 3, row-major
+    WinogradConvolution(const T *weights, Eigen::Index filters, Eigen::Index group_channels, Eigen::Index groups_)
+        : K(filters), Cg(group_channels), groups(groups_), Kg(filters / groups_), U(A2 * filters * group_channels) {
+        // U[group][xi] is a column-major Cg x Kg matrix
+        for (Eigen::Index k = 0; k < K; ++k) {
+            const Eigen::Index group = k / Kg;
+            const Eigen::Index kg = k % Kg;
+            for (Eigen::Index c = 0; c < Cg; ++c) {
+                const T *g = weights + (k * Cg + c) * 9;
+                double u[alpha][alpha];
+                transform_filter(g, u);
+                for (int xi = 0; xi < A2; ++xi) {
+                    U[((group * A2 + xi) * Kg + kg) * Cg + c] = static_cast<T>(u[xi / alpha][xi % alpha]);
+                }
+            }
+        }
+    }
+
+    /*
+        input: N x C x H x W, output: N x K x OH x OW (row-major), with
+        OH = H + 2 * pad_h - 2 and OW = W + 2 * pad_w - 2. bias may be null.
+    */
+    void operator()(const T *input, Eigen::Index N, Eigen::Index H, Eigen::Index W, Eigen::Index pad_h, Eigen::Index pad_w,
+                    const T *bias, Activation activation, T *output) const {
+        const Eigen::Index OH = H + 2 * pad_h - 2;
+        const Eigen::Index OW = W + 2 * pad_w - 2;
+        if (OH <= 0 || OW <= 0) throw std::invalid_argument("Kernel larger than padded input");
+
+        // Tiles are numbered across the whole batch so small images still give tall GEMMs
+        const Eigen::Index tiles_h = (OH + M - 1) / M;
+        const Eigen::Index tiles_w = (OW + M - 1) / M;
+        const Eigen::Index image_tiles = tiles_h * tiles_w;
+        const Eigen::Index tiles = N * image_tiles;
+        const Eigen::Index block = std::clamp<Eigen::Index>(
+            WINOGRAD_BLOCK_BYTES / (A2 * (Cg + Kg) * static_cast<Eigen::Index>(sizeof(T))), WINOGRAD_MIN_BLOCK, tiles);
+        const Eigen::Index blocks = (tiles + block - 1) / block;
+
+        parallel_for(groups * blocks, [&](Eigen::Index first, Eigen::Index last) {
+            std::vector<T> V(A2 * Cg * block), Mt(A2 * Kg * block);
+            for (Eigen::Index task = first; task < last; ++task) {
+                const Eigen::Index group = task / blocks;
+                const Eigen::Index tile_begin = (task % blocks) * block;
+                const Eigen::Index count = std::min(tiles, tile_begin + block) - tile_begin;
+
+                // V[xi] : count x Cg, column-major
+                for (Eigen::Index c = 0; c < Cg; ++c) {
+                    for (Eigen::Index t = 0; t < count; ++t) {
+                        const Eigen::Index n = (tile_begin + t) / image_tiles;
+                        const Eigen::Index tile = (tile_begin + t) % image_tiles;
+                        const T *plane = input + ((n * groups + group) * Cg + c) * H * W;
+                        T d[alpha][alpha];
+                        load_tile(plane, H, W, (tile / tiles_w) * M - pad_h, (tile % tiles_w) * M - pad_w, d);
+                        T v[alpha][alpha];
+                        transform_input(d, v);
+                        for (int xi = 0; xi < A2; ++xi) V[(xi * Cg + c) * count + t] = v[xi / alpha][xi % alpha];
+                    }
+                }
+
+                // Mt[xi] (count x Kg) = V[xi] (count x Cg) * U[xi] (Cg x Kg)
+                for (int xi = 0; xi < A2; ++xi) {
+                    gemm<T>(false, false, count, Kg, Cg, T(1), V.data() + xi * Cg * count, count,
+                            U.data() + (group * A2 + xi) * Kg * Cg, Cg, T(0), Mt.data() + xi * Kg * count, count);
+                }
+
+                for (Eigen::Index k = 0; k < Kg; ++k) {
+                    const bool has_bias = bias != nullptr;
+                    const T bk = has_bias ? bias[group * Kg + k] : T(0);
+                    for (Eigen::Index t = 0; t < count; ++t) {
+                        T m[alpha][alpha];
+                        for (int xi = 0; xi < A2; ++xi) m[xi / alpha][xi % alpha] = Mt[(xi * Kg + k) * count + t];
+                        T y[M][M];
+                        transform_output(m, y);
+
+                        const Eigen::Index n = (tile_begin + t) / image_tiles;
+                        const Eigen::Index tile = (tile_begin + t) % image_tiles;
+                        T *plane = output + (n * K + group * Kg + k) * OH * OW;
+                        const Eigen::Index oh0 = (tile / tiles_w) * M;
+                        const Eigen::Index ow0 = (tile % tiles_w) * M;
+                        const Eigen::Index rows = std::min<Eigen::Index>(M, OH - oh0);
+                        const Eigen::Index cols = std::min<Eigen::Index>(M, OW - ow0);
+                        for (Eigen::Index i = 0; i < rows; ++i) {
+                            T *dst = plane + (oh0 + i) * OW + ow0;
+                            std::copy(y[i], y[i] + cols, dst);
+                            bias_activation(dst, cols, has_bias, bk, activation);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    // u = G g G^T, in double so the stored filter carries a single rounding
+    static void transform_filter(const T *g, double (&u)[alpha][alpha]) {
+        double tmp[alpha][3];
+        for (int i = 0; i < alpha; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                tmp[i][j] = 0;
+                for (int r = 0; r < 3; ++r) tmp[i][j] += Matrices::G[i][r] * static_cast<double>(g[r * 3 + j]);
+            }
+        }
+        for (int i = 0; i < alpha; ++i) {
+            for (int j = 0; j < alpha; ++j) {
+                u[i][j] = 0;
+                for (int s = 0; s < 3; ++s) u[i][j] += tmp[i][s] * Matrices::G[j][s];
+            }
+        }
+    }
+
+    // a x a input tile with top-left corner (row, col); outside the image reads zero
+    static void load_tile(const T *plane, Eigen::Index H, Eigen::Index W, Eigen::Index row, Eigen::Index col, T (&d)[alpha][alpha]) {
+        for (int i = 0; i < alpha; ++i) {
+            const Eigen::Index ih = row + i;
+            for (int j = 0; j < alpha; ++j) {
+                const Eigen::Index iw = col + j;
+                d[i][j] = (ih >= 0 && ih < H && iw >= 0 && iw < W) ? plane[ih * W + iw] : T(0);
+            }
+        }
+    }
+
+    // The transform matrices are compile-time constants: after unrolling, the
+    // zero tests fold away and only the nonzero terms are emitted.
+
+    // v = B^T d B
+    static void transform_input(const T (&d)[alpha][alpha], T (&v)[alpha][alpha]) {
+        T tmp[alpha][alpha];
+        for (int i = 0; i < alpha; ++i) {
+            for (int j = 0; j < alpha; ++j) {
+                T sum = 0;
+                for (int r = 0; r < alpha; ++r) {
+                    if (Matrices::BT[i][r] != 0) sum += static_cast<T>(Matrices::BT[i][r]) * d[r][j];
+                }
+                tmp[i][j] = sum;
+            }
+        }
+        for (int i = 0; i < alpha; ++i) {
+            for (int j = 0; j < alpha; ++j) {
+                T sum = 0;
+                for (int s = 0; s < alpha; ++s) {
+                    if (Matrices::BT[j][s] != 0) sum += tmp[i][s] * static_cast<T>(Matrices::BT[j][s]);
+                }
+                v[i][j] = sum;
+            }
+        }
+    }
+
+    // y = A^T m A
+    static void transform_output(const T (&m)[alpha][alpha], T (&y)[M][M]) {
+        T tmp[M][alpha];
+        for (int i = 0; i < M; ++i) {
+            for (int j = 0; j < alpha; ++j) {
+                T sum = 0;
+                for (int r = 0; r < alpha; ++r) {
+                    if (Matrices::AT[i][r] != 0) sum += static_cast<T>(Matrices::AT[i][r]) * m[r][j];
+                }
+                tmp[i][j] = sum;
+            }
+        }
+        for (int i = 0; i < M; ++i) {
+            for (int j = 0; j < M; ++j) {
+                T sum = 0;
+                for (int s = 0; s < alpha; ++s) {
+                    if (Matrices::AT[j][s] != 0) sum += tmp[i][s] * static_cast<T>(Matrices::AT[j][s]);
+                }
+                y[i][j] = sum;
+            }
+        }
+    }
+
+    Eigen::Index K, Cg, groups, Kg;
+    std::vector<T> U;
+};
+
+#endif
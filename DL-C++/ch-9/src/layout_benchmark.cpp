@@ -0,0 +1,102 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv2d_layer.hpp"
+#include "includes/depthwise.hpp"
+
+/*
+    Layout conversions: the tiled register transposes of layout.hpp against
+    a plain element-by-element loop over the logical (n, c, h, w) index, on
+    a 16 x 64 x 56 x 56 float activation, with a round trip back to NCHW as
+    the correctness check.
+
+    Then a small network whose layers prefer different layouts, run by
+    converting the activation to each layer's preferred_layout with to(),
+    which only copies at the two places where the preference changes.
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+
+template <typename Fn>
+double best_time_ms(Fn &&fn) {
+    double best = 1e30;
+    for (int r = 0; r < 5; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+    }
+    return best;
+}
+
+LayoutTensor<float> naive_convert(const LayoutTensor<float> &x, Layout target) {
+    LayoutTensor<float> result(target, x.batch(), x.channels(), x.height(), x.width());
+    for (Eigen::Index n = 0; n < x.batch(); ++n)
+    for (Eigen::Index c = 0; c < x.channels(); ++c)
+    for (Eigen::Index h = 0; h < x.height(); ++h)
+    for (Eigen::Index w = 0; w < x.width(); ++w) {
+        result(n, c, h, w) = x(n, c, h, w);
+    }
+    return result;
+}
+
+int main() {
+    Tensor4D activation(16, 64, 56, 56);
+    activation.setRandom();
+    const LayoutTensor<float> nchw(activation, Layout::NCHW);
+    const double megabytes = activation.size() * sizeof(float) / (1024.0 * 1024.0);
+
+    std::cout << "16 x 64 x 56 x 56 float (" << megabytes << " MB)\n";
+    std::cout << "conversion          naive ms  tiled ms  speedup  round trip\n";
+    const std::vector<std::pair<Layout, Layout>> conversions = {
+        {Layout::NCHW, Layout::NHWC}, {Layout::NCHW, Layout::NCHW8c}, {Layout::NCHW, Layout::NCHW16c},
+        {Layout::NHWC, Layout::NCHW8c}, {Layout::NCHW8c, Layout::NCHW16c}};
+    for (const auto &[from, to] : conversions) {
+        const LayoutTensor<float> source = nchw.to(from);
+        LayoutTensor<float> naive, tiled;
+        const double naive_ms = best_time_ms([&] { naive = naive_convert(source, to); });
+        const double tiled_ms = best_time_ms([&] { tiled = source.to(to); });
+        Tensor4D back = tiled.to(Layout::NCHW).tensor();
+        Eigen::Tensor<float, 0, Eigen::RowMajor> diff = (back - activation).abs().maximum();
+
+        std::cout << std::left << std::setw(8) << layout_name(from) << "-> " << std::setw(8) << layout_name(to) << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(9) << naive_ms << std::setw(10) << tiled_ms
+                  << std::setw(8) << naive_ms / tiled_ms << "x" << std::setw(12) << (diff() == 0 ? "exact" : "MISMATCH")
+                  << std::defaultfloat << "\n";
+    }
+
+    // conv 3x3 (NCHW) -> conv 1x1 (NCHW) -> depthwise 3x3 (NHWC) -> depthwise 3x3 (NHWC) -> conv 1x1 (NCHW)
+    Conv2DOptions same;
+    same.pad_h = same.pad_w = 1;
+    same.activation = Activation::ReLU;
+    Tensor4D w3(64, 64, 3, 3), w1(64, 64, 1, 1), w_out(32, 64, 1, 1);
+    Eigen::Tensor<float, 3, Eigen::RowMajor> dw(3, 3, 64);
+    Tensor1D b64(64), b32(32);
+    for (auto *t : {&w3, &w1, &w_out}) t->setRandom();
+    dw.setRandom();
+    b64.setRandom();
+    b32.setRandom();
+    Conv2D<float> conv3(w3, b64, same), conv1(w1, b64), conv_out(w_out, b32);
+    DepthwiseOptions dw_options;
+    dw_options.pad_h = dw_options.pad_w = 1;
+    DepthwiseConv2D<float> depthwise(dw, b64, dw_options);
+
+    int conversions_done = 0;
+    auto into = [&](LayoutTensor<float> x, Layout layout) {
+        if (x.layout() != layout) ++conversions_done;
+        return std::move(x).to(layout);
+    };
+    LayoutTensor<float> x = nchw;
+    x = LayoutTensor<float>(conv3(into(std::move(x), Conv2D<float>::preferred_layout).tensor()), Layout::NCHW);
+    x = LayoutTensor<float>(conv1(into(std::move(x), Conv2D<float>::preferred_layout).tensor()), Layout::NCHW);
+    x = LayoutTensor<float>(depthwise(into(std::move(x), DepthwiseConv2D<float>::preferred_layout).tensor()), Layout::NHWC);
+    x = LayoutTensor<float>(depthwise(into(std::move(x), DepthwiseConv2D<float>::preferred_layout).tensor()), Layout::NHWC);
+    x = LayoutTensor<float>(conv_out(into(std::move(x), Conv2D<float>::preferred_layout).tensor()), Layout::NCHW);
+
+    std::cout << "\nconv3x3 -> conv1x1 -> depthwise -> depthwise -> conv1x1: " << conversions_done
+              << " layout conversions, output " << x.batch() << " x " << x.channels() << " x " << x.height() << " x "
+              << x.width() << " in " << layout_name(x.layout()) << "\n";
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "includes/conv2d_layer.hpp"
+
+/*
+    im2col against Winograd F(2x2, 3x3) and F(4x4, 3x3) on stride-1, padding-1
+    3x3 layers. Times are the best of three runs; the error column is
+    max |output - reference| / max |reference| with a double-precision im2col
+    reference, and is checked against the budget documented in winograd.hpp.
+*/
+
+using Tensor4D = Conv2D<float>::Tensor4D;
+using Tensor1D = Conv2D<float>::Tensor1D;
+using Tensor4D_d = Conv2D<double>::Tensor4D;
+using Tensor1D_d = Conv2D<double>::Tensor1D;
+
+struct Layer {
+    Eigen::Index batch, channels, filters, size;
+};
+
+int main() {
+    const std::vector<Layer> layers = {
+        {8, 24, 24, 56}, {8, 32, 32, 56}, {8, 64, 64, 56}, {8, 128, 128, 28}, {8, 256, 256, 14}, {8, 512, 512, 7}};
+    const ConvAlgorithm algorithms[] = {ConvAlgorithm::Im2col, ConvAlgorithm::Winograd2x2, ConvAlgorithm::Winograd4x4};
+    const double budget[] = {5e-6, 5e-6, 1e-5};
+    bool within_budget = true;
+
+    std::cout << "layer (N x C x H, K)      im2col ms (err)      F(2x2) ms (err)      F(4x4) ms (err)   auto\n";
+    for (const Layer &layer : layers) {
+        Tensor4D input(layer.batch, layer.channels, layer.size, layer.size);
+        Tensor4D weights(layer.filters, layer.channels, 3, 3);
+        Tensor1D bias(layer.filters);
+        input.setRandom();
+        weights.setRandom();
+        bias.setRandom();
+
+        Conv2DOptions options;
+        options.pad_h = options.pad_w = 1;
+        options.algorithm = ConvAlgorithm::Im2col;
+        Tensor4D_d reference = Conv2D<double>(weights.cast<double>(), bias.cast<double>(), options)(input.cast<double>());
+        Eigen::Tensor<double, 0, Eigen::RowMajor> scale = reference.abs().maximum();
+
+        std::cout << std::setw(4) << layer.batch << " x" << std::setw(4) << layer.channels << " x" << std::setw(4) << layer.size
+                  << ", K =" << std::setw(4) << layer.filters;
+        for (int a = 0; a < 3; ++a) {
+            options.algorithm = algorithms[a];
+            Conv2D<float> conv(weights, bias, options);
+            Tensor4D output;
+            double best = 1e30;
+            for (int r = 0; r < 3; ++r) {
+                auto start = std::chrono::steady_clock::now();
+                output = conv(input);
+                auto stop = std::chrono::steady_clock::now();
+                best = std::min(best, std::chrono::duration<double, std::milli>(stop - start).count());
+            }
+            Eigen::Tensor<double, 0, Eigen::RowMajor> error = (output.cast<double>() - reference).abs().maximum();
+            const double relative = error() / scale();
+            within_budget = within_budget && relative <= budget[a];
+            std::cout << std::fixed << std::setprecision(1) << std::setw(10) << best << " ("
+                      << std::scientific << std::setprecision(1) << relative << ")" << std::defaultfloat;
+        }
+
+        options.algorithm = ConvAlgorithm::Auto;
+        Conv2D<float> automatic(weights, bias, options);
+        std::cout << "   " << (automatic.selected_algorithm(layer.size, layer.size) == ConvAlgorithm::Im2col ? "im2col" : "F(4x4)") << "\n";
+    }
+
+    std::cout << (within_budget ? "All errors within budget" : "ERROR BUDGET EXCEEDED") << std::endl;
+    return within_budget ? 0 : 1;
+}
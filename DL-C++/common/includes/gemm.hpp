@@ -0,0 +1,55 @@
+#ifndef __MY_GEMM__
+#define __MY_GEMM__
+
+#include <Eigen/Core>
+
+/*
+    General matrix multiply shared by the dense and convolution layers:
+
+        C = alpha * op(A) * op(B) + beta * C
+
+    with BLAS conventions: column-major storage, op(X) = X or X^T, and leading
+    dimensions lda/ldb/ldc so sub-blocks can be addressed in place. op(A) is
+    m x k, op(B) is k x n and C is m x n. The product itself is Eigen's
+    cache-blocked, packed GEMM kernel applied to raw buffers through Maps, so
+    no copies are made.
+
+    A row-major matrix is the transpose of the same buffer read column-major,
+    so row-major callers compute C^T = op(B)^T * op(A)^T by swapping operands.
+*/
+
+template <typename T>
+using ConstMatrixMap = Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>, 0, Eigen::OuterStride<>>;
+
+template <typename T>
+using MatrixMap = Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>, 0, Eigen::OuterStride<>>;
+
+template <typename T>
+void gemm(bool trans_a, bool trans_b, Eigen::Index m, Eigen::Index n, Eigen::Index k,
+          T alpha, const T *A, Eigen::Index lda, const T *B, Eigen::Index ldb,
+          T beta, T *C, Eigen::Index ldc) {
+    if (m == 0 || n == 0) return;
+
+    MatrixMap<T> c(C, m, n, Eigen::OuterStride<>(ldc));
+    if (beta == T(0)) {
+        c.setZero();
+    } else if (beta != T(1)) {
+        c *= beta;
+    }
+    if (k == 0 || alpha == T(0)) return;
+
+    ConstMatrixMap<T> a(A, trans_a ? k : m, trans_a ? m : k, Eigen::OuterStride<>(lda));
+    ConstMatrixMap<T> b(B, trans_b ? n : k, trans_b ? k : n, Eigen::OuterStride<>(ldb));
+
+    if (!trans_a && !trans_b) {
+        c.noalias() += alpha * a * b;
+    } else if (!trans_a && trans_b) {
+        c.noalias() += alpha * a * b.transpose();
+    } else if (trans_a && !trans_b) {
+        c.noalias() += alpha * a.transpose() * b;
+    } else {
+        c.noalias() += alpha * a.transpose() * b.transpose();
+    }
+}
+
+#endif
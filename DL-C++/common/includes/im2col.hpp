@@ -0,0 +1,179 @@
+#ifndef __MY_IM2COL__
+#define __MY_IM2COL__
+
+#include <algorithm>
+#include <Eigen/Core>
+
+#include "gemm.hpp"
+
+/*
+    im2col + GEMM convolution, shared by the convolution code of every chapter.
+
+    Images are row-major C x H x W buffers, filters are row-major
+    K x C x R x S buffers, and the convolution is the cross-correlation used by
+    CNNs (the kernel is not flipped), like the block loop in ch-4's
+    convolution_2d_example.cpp.
+
+    im2col() unrolls every receptive field into a column so the whole
+    convolution becomes matrix products:
+
+        col     : (C*R*S) x P   one column per output pixel (P = OH * OW)
+        weights : K x (C*R*S)
+        output  : K x P       = weights * col
+
+    Stored row-major, col is column-major P x (C*R*S), so the product is
+    issued to gemm() as output^T = col^T * weights^T with no transposes.
+*/
+
+struct ConvGeometry {
+    Eigen::Index channels = 1;
+    Eigen::Index height = 0;
+    Eigen::Index width = 0;
+    Eigen::Index kernel_h = 1;
+    Eigen::Index kernel_w = 1;
+    Eigen::Index stride_h = 1;
+    Eigen::Index stride_w = 1;
+    Eigen::Index pad_h = 0;
+    Eigen::Index pad_w = 0;
+    Eigen::Index dilation_h = 1;
+    Eigen::Index dilation_w = 1;
+
+    Eigen::Index out_h() const { return (height + 2 * pad_h - dilation_h * (kernel_h - 1) - 1) / stride_h + 1; }
+    Eigen::Index out_w() const { return (width + 2 * pad_w - dilation_w * (kernel_w - 1) - 1) / stride_w + 1; }
+    Eigen::Index patch_size() const { return channels * kernel_h * kernel_w; }
+    Eigen::Index image_size() const { return channels * height * width; }
+};
+
+// Output positions [first, last) whose input index o * stride + tap_offset
+// falls inside [0, size); the rest read padding
+inline void valid_output_range(Eigen::Index tap_offset, Eigen::Index stride, Eigen::Index size, Eigen::Index out_size,
+                               Eigen::Index &first, Eigen::Index &last) {
+    first = tap_offset >= 0 ? 0 : (-tap_offset + stride - 1) / stride;
+    last = size - tap_offset <= 0 ? 0 : (size - tap_offset + stride - 1) / stride;
+    first = std::min(first, out_size);
+    last = std::clamp(last, first, out_size);
+}
+
+/*
+    Unrolls output rows [row_begin, row_end) of a single image into col, a
+    row-major (C*R*S) x ((row_end - row_begin) * OW) buffer. Restricting the
+    rows lets callers lower a band of the output at a time.
+*/
+template <typename T>
+void im2col(const T *image, const ConvGeometry &g, Eigen::Index row_begin, Eigen::Index row_end, T *col) {
+    const Eigen::Index OW = g.out_w();
+    const Eigen::Index band = (row_end - row_begin) * OW;
+
+    for (Eigen::Index c = 0; c < g.channels; ++c) {
+        const T *plane = image + c * g.height * g.width;
+        for (Eigen::Index r = 0; r < g.kernel_h; ++r) {
+            for (Eigen::Index s = 0; s < g.kernel_w; ++s) {
+                T *dst = col + ((c * g.kernel_h + r) * g.kernel_w + s) * band;
+
+                const Eigen::Index col_offset = s * g.dilation_w - g.pad_w;
+                Eigen::Index ow_first, ow_last;
+                valid_output_range(col_offset, g.stride_w, g.width, OW, ow_first, ow_last);
+
+                for (Eigen::Index oh = row_begin; oh < row_end; ++oh, dst += OW) {
+                    const Eigen::Index ih = oh * g.stride_h - g.pad_h + r * g.dilation_h;
+                    if (ih < 0 || ih >= g.height) {
+                        std::fill(dst, dst + OW, T(0));
+                        continue;
+                    }
+                    const T *src = plane + ih * g.width;
+                    std::fill(dst, dst + ow_first, T(0));
+                    if (g.stride_w == 1) {
+                        std::copy(src + ow_first + col_offset, src + ow_last + col_offset, dst + ow_first);
+                    } else {
+                        for (Eigen::Index ow = ow_first; ow < ow_last; ++ow) dst[ow] = src[ow * g.stride_w + col_offset];
+                    }
+                    std::fill(dst + ow_last, dst + OW, T(0));
+                }
+            }
+        }
+    }
+}
+
+/*
+    Adjoint of im2col(): adds every entry of the (C*R*S) x band buffer col back
+    onto the image pixel it was copied from, so overlapping receptive fields
+    sum. Padding taps are dropped. Used for the input gradient and for
+    transposed convolution.
+*/
+template <typename T>
+void col2im(const T *col, const ConvGeometry &g, Eigen::Index row_begin, Eigen::Index row_end, T *image) {
+    const Eigen::Index OW = g.out_w();
+    const Eigen::Index band = (row_end - row_begin) * OW;
+
+    for (Eigen::Index c = 0; c < g.channels; ++c) {
+        T *plane = image + c * g.height * g.width;
+        for (Eigen::Index r = 0; r < g.kernel_h; ++r) {
+            for (Eigen::Index s = 0; s < g.kernel_w; ++s) {
+                const T *src = col + ((c * g.kernel_h + r) * g.kernel_w + s) * band;
+
+                const Eigen::Index col_offset = s * g.dilation_w - g.pad_w;
+                Eigen::Index ow_first, ow_last;
+                valid_output_range(col_offset, g.stride_w, g.width, OW, ow_first, ow_last);
+
+                for (Eigen::Index oh = row_begin; oh < row_end; ++oh, src += OW) {
+                    const Eigen::Index ih = oh * g.stride_h - g.pad_h + r * g.dilation_h;
+                    if (ih < 0 || ih >= g.height) continue;
+                    T *dst = plane + ih * g.width;
+                    for (Eigen::Index ow = ow_first; ow < ow_last; ++ow) dst[ow * g.stride_w + col_offset] += src[ow];
+                }
+            }
+        }
+    }
+}
+
+// Output rows lowered per GEMM call: the band of col is sized to stay in L2
+// so the unrolled patches are consumed while still cached
+constexpr Eigen::Index IM2COL_BAND_BYTES = 256 * 1024;
+
+template <typename T>
+Eigen::Index im2col_band_rows(const ConvGeometry &g) {
+    const Eigen::Index row_bytes = g.patch_size() * g.out_w() * static_cast<Eigen::Index>(sizeof(T));
+    return std::clamp<Eigen::Index>(IM2COL_BAND_BYTES / std::max<Eigen::Index>(row_bytes, 1), 1, g.out_h());
+}
+
+// A 1x1, stride-1, unpadded convolution reads the image itself as col
+inline bool is_pointwise(const ConvGeometry &g) {
+    return g.kernel_h == 1 && g.kernel_w == 1 && g.stride_h == 1 && g.stride_w == 1 && g.pad_h == 0 && g.pad_w == 0;
+}
+
+/*
+    Output rows [row_begin, row_end) of every output channel:
+    output (K x OH x OW, row-major) = weights (K x C x R x S) conv image.
+    col must hold patch_size() * (row_end - row_begin) * OW elements.
+*/
+template <typename T>
+void conv2d_im2col_rows(const T *image, const ConvGeometry &g, const T *weights, Eigen::Index out_channels,
+                        T *output, T *col, Eigen::Index row_begin, Eigen::Index row_end) {
+    const Eigen::Index OW = g.out_w();
+    const Eigen::Index P = g.out_h() * OW;
+    const Eigen::Index CRS = g.patch_size();
+    const Eigen::Index band = (row_end - row_begin) * OW;
+
+    if (is_pointwise(g)) {
+        gemm<T>(false, false, band, out_channels, CRS, T(1), image + row_begin * OW, g.height * g.width,
+                weights, CRS, T(0), output + row_begin * OW, P);
+        return;
+    }
+    im2col(image, g, row_begin, row_end, col);
+    gemm<T>(false, false, band, out_channels, CRS, T(1), col, band, weights, CRS, T(0), output + row_begin * OW, P);
+}
+
+/*
+    Whole image, one band of output rows at a time; col must hold
+    patch_size() * im2col_band_rows() * OW elements.
+*/
+template <typename T>
+void conv2d_im2col(const T *image, const ConvGeometry &g, const T *weights, Eigen::Index out_channels, T *output, T *col) {
+    const Eigen::Index OH = g.out_h();
+    const Eigen::Index band_rows = im2col_band_rows<T>(g);
+    for (Eigen::Index row_begin = 0; row_begin < OH; row_begin += band_rows) {
+        conv2d_im2col_rows(image, g, weights, out_channels, output, col, row_begin, std::min(OH, row_begin + band_rows));
+    }
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef __MY_PARALLEL__
+#define __MY_PARALLEL__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Eigen/Core>
+
+/*
+    Minimal fork-join helpers shared by the chapters.
+
+    parallel_for() splits [0, count) into one contiguous range per thread and
+    calls fn(begin, end) on each range; the calling thread takes the first one.
+    The split only depends on count and the thread count, so kernels that write
+    disjoint outputs per index are deterministic.
+
+    The other ranges run on a process-wide pool of threads that are started
+    once and then sleep on a condition variable between calls, so a call
+    costs a wake-up and a join on a counter (microseconds) rather than
+    creating and joining a thread per range, which would eat the gains on
+    small layers, optimizer steps and reductions that call it on every step.
+    The pool grows to the largest thread count asked for. A call made from
+    inside a pool task, or while another thread holds the pool, runs the
+    same ranges one after the other on the calling thread.
+*/
+
+class ThreadPool {
+public:
+    static ThreadPool &instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto &thread : threads_) thread.join();
+    }
+
+    // task(t) for t in [0, tasks): task 0 on the calling thread, the others on
+    // pool threads. Returns false, running nothing, if the pool is in use.
+    bool run(Eigen::Index tasks, const std::function<void(Eigen::Index)> &task) {
+        bool expected = false;
+        if (!busy_.compare_exchange_strong(expected, true)) return false;
+        while (Eigen::Index(threads_.size()) < tasks - 1) threads_.emplace_back([this] { work(); });
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            next_ = 1;
+            tasks_ = tasks;
+            pending_ = tasks - 1;
+        }
+        wake_.notify_all();
+        task(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return pending_ == 0; });
+            task_ = nullptr;
+        }
+        busy_.store(false);
+        return true;
+    }
+
+private:
+    ThreadPool() = default;
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] { return stop_ || (task_ != nullptr && next_ < tasks_); });
+            if (stop_) return;
+            const Eigen::Index t = next_++;
+            const std::function<void(Eigen::Index)> &task = *task_;
+            lock.unlock();
+            task(t);
+            lock.lock();
+            if (--pending_ == 0) done_.notify_one();
+        }
+    }
+
+    std::atomic<bool> busy_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    const std::function<void(Eigen::Index)> *task_ = nullptr;
+    Eigen::Index next_ = 0, tasks_ = 0, pending_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+inline int &num_threads_setting() {
+    static int setting = 0;
+    return setting;
+}
+
+// 0 restores the default (one thread per hardware core)
+inline void set_num_threads(int threads) { num_threads_setting() = std::max(0, threads); }
+
+inline int get_num_threads() {
+    if (num_threads_setting() > 0) return num_threads_setting();
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+template <typename Fn>
+void parallel_for(Eigen::Index count, Fn &&fn, int num_threads = get_num_threads()) {
+    if (count <= 0) return;
+    const Eigen::Index threads = std::max<Eigen::Index>(1, std::min<Eigen::Index>(num_threads, count));
+    if (threads == 1) {
+        fn(Eigen::Index(0), count);
+        return;
+    }
+
+    auto range_begin = [count, threads](Eigen::Index t) { return t * count / threads; };
+
+    std::vector<std::exception_ptr> errors(threads);
+    auto range = [&](Eigen::Index t) {
+        try {
+            fn(range_begin(t), range_begin(t + 1));
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    if (!ThreadPool::instance().run(threads, range)) {
+        for (Eigen::Index t = 0; t < threads; ++t) range(t);
+    }
+
+    for (auto &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+#endif